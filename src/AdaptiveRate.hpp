@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Per-connection send interval driven by ping/pong measurements.
+//
+// Every probe records the bytes handed to the socket and the bytes still
+// queued; when the pong arrives that gives the RTT and how fast the client
+// actually drained its queue. A client that cannot clear its backlog within
+// one interval (or whose RTT balloons) has its interval doubled, up to
+// `slowest_ms`; a client that keeps up gets it shortened again by a quarter
+// per probe until it is back at the configured rate.
+class AdaptiveRate {
+private:
+    uint32_t base_ms_;      // configured broadcast period
+    uint32_t slowest_ms_;   // floor of the update frequency
+    uint32_t interval_ms_;  // 0 = not throttled
+
+    bool probe_outstanding_;
+    int64_t probe_sent_us_;
+    uint64_t probe_bytes_sent_;
+    size_t probe_buffered_;
+
+    double rtt_ms_;      // smoothed
+    double min_rtt_ms_;  // best seen, the path's baseline
+    double drain_bytes_per_ms_;
+
+    void slow_down() {
+        uint32_t next = std::max(base_ms_, interval_ms_ * 2);
+        interval_ms_ = std::min(next, slowest_ms_);
+    }
+
+    void speed_up() {
+        uint32_t next = interval_ms_ - interval_ms_ / 4;
+        interval_ms_ = next <= base_ms_ ? 0 : next;
+    }
+
+public:
+    AdaptiveRate(uint32_t base_ms = 50, uint32_t slowest_ms = 1000)
+        : base_ms_(std::max<uint32_t>(1, base_ms))
+        , slowest_ms_(std::max(base_ms, slowest_ms))
+        , interval_ms_(0)
+        , probe_outstanding_(false)
+        , probe_sent_us_(0)
+        , probe_bytes_sent_(0)
+        , probe_buffered_(0)
+        , rtt_ms_(0.0)
+        , min_rtt_ms_(0.0)
+        , drain_bytes_per_ms_(0.0)
+    {}
+
+    bool probe_outstanding() const {
+        return probe_outstanding_;
+    }
+
+    void on_probe_sent(int64_t now_us, uint64_t bytes_sent, size_t buffered) {
+        probe_outstanding_ = true;
+        probe_sent_us_ = now_us;
+        probe_bytes_sent_ = bytes_sent;
+        probe_buffered_ = buffered;
+    }
+
+    // Returns true if the interval changed
+    bool on_pong(int64_t now_us, uint64_t bytes_sent, size_t buffered) {
+        if (!probe_outstanding_) {
+            return false;
+        }
+        probe_outstanding_ = false;
+
+        double rtt = std::max(0.001, (now_us - probe_sent_us_) / 1000.0);
+        rtt_ms_ = rtt_ms_ == 0.0 ? rtt : 0.8 * rtt_ms_ + 0.2 * rtt;
+        min_rtt_ms_ = min_rtt_ms_ == 0.0 ? rtt : std::min(min_rtt_ms_, rtt);
+
+        // Everything queued at the probe, plus what was queued since, minus
+        // what is still waiting, reached the client in `rtt`
+        double drained = static_cast<double>(bytes_sent - probe_bytes_sent_) +
+                         static_cast<double>(probe_buffered_) - static_cast<double>(buffered);
+        double rate = std::max(0.0, drained) / rtt;
+        drain_bytes_per_ms_ = drain_bytes_per_ms_ == 0.0 ? rate : 0.7 * drain_bytes_per_ms_ + 0.3 * rate;
+
+        double period_ms = std::max(interval_ms_, base_ms_);
+        double backlog_ms = buffered == 0 ? 0.0
+                          : drain_bytes_per_ms_ > 0.0 ? buffered / drain_bytes_per_ms_
+                          : 1e9;
+        bool rtt_inflated = rtt_ms_ > 4.0 * min_rtt_ms_ && rtt_ms_ > period_ms;
+
+        uint32_t before = interval_ms_;
+        if (backlog_ms > period_ms || rtt_inflated) {
+            slow_down();
+        } else if (interval_ms_ != 0 && backlog_ms < period_ms / 4 && rtt_ms_ < 2.0 * min_rtt_ms_ + period_ms) {
+            speed_up();
+        }
+        return interval_ms_ != before;
+    }
+
+    // No pong within the transport's timeout: treat as congestion
+    bool on_pong_timeout() {
+        probe_outstanding_ = false;
+        uint32_t before = interval_ms_;
+        slow_down();
+        return interval_ms_ != before;
+    }
+
+    uint32_t interval_ms() const { return interval_ms_; }
+    double rtt_ms() const { return rtt_ms_; }
+    double drain_bytes_per_s() const { return drain_bytes_per_ms_ * 1000.0; }
+};
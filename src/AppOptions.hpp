@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+// Command line: <program> <role> [--key value | --key=value | --flag]...
+// Tools without a role pass with_role = false.
+class AppOptions {
+private:
+    std::string role_;
+    std::map<std::string, std::string> values_;
+
+public:
+    static AppOptions parse(int argc, char** argv, bool with_role = true) {
+        AppOptions options;
+        int first = with_role ? 2 : 1;
+        if (with_role && argc >= 2) {
+            options.role_ = argv[1];
+        }
+
+        for (int i = first; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                throw std::runtime_error("Unexpected argument: " + arg);
+            }
+            arg = arg.substr(2);
+
+            auto eq = arg.find('=');
+            if (eq != std::string::npos) {
+                options.values_[arg.substr(0, eq)] = arg.substr(eq + 1);
+            } else if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+                options.values_[arg] = argv[++i];
+            } else {
+                options.values_[arg] = "";  // flag
+            }
+        }
+        return options;
+    }
+
+    const std::string& role() const {
+        return role_;
+    }
+
+    bool has(const std::string& key) const {
+        return values_.count(key) != 0;
+    }
+
+    std::string get_string(const std::string& key, const std::string& fallback = "") const {
+        auto it = values_.find(key);
+        return it == values_.end() ? fallback : it->second;
+    }
+
+    uint32_t get_uint(const std::string& key, uint32_t fallback) const {
+        auto it = values_.find(key);
+        if (it == values_.end()) {
+            return fallback;
+        }
+        try {
+            return static_cast<uint32_t>(std::stoul(it->second));
+        } catch (const std::exception&) {
+            throw std::runtime_error("Invalid value for --" + key + ": " + it->second);
+        }
+    }
+
+    double get_double(const std::string& key, double fallback) const {
+        auto it = values_.find(key);
+        if (it == values_.end()) {
+            return fallback;
+        }
+        try {
+            return std::stod(it->second);
+        } catch (const std::exception&) {
+            throw std::runtime_error("Invalid value for --" + key + ": " + it->second);
+        }
+    }
+};
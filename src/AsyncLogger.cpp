@@ -0,0 +1,154 @@
+#include "AsyncLogger.hpp"
+
+#include <ctime>
+
+std::atomic<uint8_t> AsyncLogger::min_level_(static_cast<uint8_t>(LogLevel::Info));
+
+AsyncLogger& AsyncLogger::instance() {
+    static AsyncLogger logger;
+    return logger;
+}
+
+bool AsyncLogger::parse_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") {
+        level = LogLevel::Debug;
+    } else if (name == "info") {
+        level = LogLevel::Info;
+    } else if (name == "warn") {
+        level = LogLevel::Warn;
+    } else if (name == "error") {
+        level = LogLevel::Error;
+    } else if (name == "off") {
+        level = LogLevel::Off;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+AsyncLogger::AsyncLogger()
+    : slots_(new Slot[kCapacity])
+    , enqueue_pos_(0)
+    , dequeue_pos_(0)
+    , dropped_(0)
+    , running_(true)
+{
+    for (size_t i = 0; i < kCapacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    flusher_ = std::thread(&AsyncLogger::flush_loop, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    shutdown();
+}
+
+// Bounded MPSC ring (Vyukov): each slot's sequence says whose turn it is
+bool AsyncLogger::push(LogLevel level, const char* text, size_t length) {
+    const size_t mask = kCapacity - 1;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots_[pos & mask];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (length > kLineSize) {
+        length = kLineSize;
+    }
+    slot->level = level;
+    slot->time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    slot->length = static_cast<uint32_t>(length);
+    std::memcpy(slot->text, text, length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::pop(Slot& out) {
+    Slot& slot = slots_[dequeue_pos_ & (kCapacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+        return false;
+    }
+    out.level = slot.level;
+    out.time_us = slot.time_us;
+    out.length = slot.length;
+    std::memcpy(out.text, slot.text, slot.length);
+    slot.sequence.store(dequeue_pos_ + kCapacity, std::memory_order_release);
+    ++dequeue_pos_;
+    return true;
+}
+
+size_t AsyncLogger::drain() {
+    static const char* const kLevelNames[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    Slot line;
+    size_t count = 0;
+    bool wrote_out = false;
+    bool wrote_err = false;
+    while (pop(line)) {
+        time_t seconds = static_cast<time_t>(line.time_us / 1000000);
+        struct tm local;
+        localtime_r(&seconds, &local);
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%H:%M:%S", &local);
+
+        bool is_error = line.level >= LogLevel::Warn;
+        FILE* out = is_error ? stderr : stdout;
+        fprintf(out, "%s.%03d %s %.*s\n", stamp,
+                static_cast<int>((line.time_us / 1000) % 1000),
+                kLevelNames[static_cast<uint8_t>(line.level) & 3],
+                static_cast<int>(line.length), line.text);
+        wrote_err = wrote_err || is_error;
+        wrote_out = wrote_out || !is_error;
+        ++count;
+    }
+
+    // One flush per batch instead of one per line (std::endl)
+    if (wrote_out) {
+        fflush(stdout);
+    }
+    if (wrote_err) {
+        fflush(stderr);
+    }
+    return count;
+}
+
+void AsyncLogger::flush_loop() {
+    uint64_t reported_drops = 0;
+    while (running_.load()) {
+        if (drain() == 0) {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(10));
+        }
+
+        uint64_t drops = dropped_.load(std::memory_order_relaxed);
+        if (drops != reported_drops) {
+            fprintf(stderr, "[AsyncLogger] ring full, %llu lines dropped so far\n",
+                    static_cast<unsigned long long>(drops));
+            reported_drops = drops;
+        }
+    }
+    drain();
+}
+
+void AsyncLogger::shutdown() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wake_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Asynchronous logging for hot paths.
+//
+// Call sites format into a stack buffer and push the line into a bounded
+// lock-free ring; a background thread writes batches to stdout (Debug/Info)
+// or stderr (Warn/Error). A full ring drops the line instead of blocking.
+//
+//   APP_LOG_INFO("WebSocket") << "Client connected. Total: " << n;
+//   APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Send failed: " << what;
+
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Off = 4
+};
+
+class AsyncLogger {
+public:
+    static const size_t kLineSize = 256;
+    static const size_t kCapacity = 4096;  // lines, power of two
+
+    static AsyncLogger& instance();
+
+    static bool enabled(LogLevel level) {
+        return static_cast<uint8_t>(level) >= min_level_.load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogLevel level) {
+        min_level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+
+    // "debug", "info", "warn", "error", "off"; false if not recognised
+    static bool parse_level(const std::string& name, LogLevel& level);
+
+    // Never blocks; returns false (and counts the line) if the ring is full
+    bool push(LogLevel level, const char* text, size_t length);
+
+    // Drain everything queued so far and stop the flusher thread
+    void shutdown();
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    ~AsyncLogger();
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        int64_t time_us;
+        uint32_t length;
+        char text[kLineSize];
+    };
+
+    AsyncLogger();
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    bool pop(Slot& out);
+    void flush_loop();
+    size_t drain();
+
+    static std::atomic<uint8_t> min_level_;
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> enqueue_pos_;
+    size_t dequeue_pos_;  // single consumer
+    std::atomic<uint64_t> dropped_;
+
+    std::atomic<bool> running_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::thread flusher_;
+};
+
+// One log statement, formatted into a fixed buffer (long lines are cut)
+class LogLine {
+private:
+    LogLevel level_;
+    size_t length_;
+    char buffer_[AsyncLogger::kLineSize];
+
+    void append(const char* text, size_t n) {
+        size_t room = sizeof(buffer_) - length_;
+        if (n > room) {
+            n = room;
+        }
+        std::memcpy(buffer_ + length_, text, n);
+        length_ += n;
+    }
+
+public:
+    LogLine(LogLevel level, const char* tag, uint64_t suppressed = 0)
+        : level_(level)
+        , length_(0)
+    {
+        *this << '[' << tag << "] ";
+        if (suppressed > 0) {
+            *this << "(" << suppressed << " similar suppressed) ";
+        }
+    }
+
+    ~LogLine() {
+        AsyncLogger::instance().push(level_, buffer_, length_);
+    }
+
+    LogLine& operator<<(const char* text) {
+        append(text, std::strlen(text));
+        return *this;
+    }
+
+    LogLine& operator<<(const std::string& text) {
+        append(text.data(), text.size());
+        return *this;
+    }
+
+    LogLine& operator<<(char c) {
+        append(&c, 1);
+        return *this;
+    }
+
+    LogLine& operator<<(bool b) {
+        return *this << (b ? "true" : "false");
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, LogLine&>::type
+    operator<<(T value) {
+        char tmp[24];
+        int n = snprintf(tmp, sizeof(tmp), "%lld", static_cast<long long>(value));
+        append(tmp, static_cast<size_t>(n));
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, LogLine&>::type
+    operator<<(T value) {
+        char tmp[24];
+        int n = snprintf(tmp, sizeof(tmp), "%llu", static_cast<unsigned long long>(value));
+        append(tmp, static_cast<size_t>(n));
+        return *this;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, LogLine&>::type
+    operator<<(T value) {
+        char tmp[32];
+        int n = snprintf(tmp, sizeof(tmp), "%.10g", static_cast<double>(value));
+        append(tmp, static_cast<size_t>(n));
+        return *this;
+    }
+};
+
+// Per call-site limit: at most `per_second` lines, the rest are counted and
+// reported on the next line that gets through.
+class LogRateLimiter {
+private:
+    int64_t interval_us_;
+    std::atomic<int64_t> next_allowed_us_;
+    std::atomic<uint64_t> suppressed_;
+
+public:
+    struct Ticket {
+        bool allowed;
+        uint64_t suppressed;
+    };
+
+    explicit LogRateLimiter(double per_second)
+        : interval_us_(per_second > 0.0 ? static_cast<int64_t>(1e6 / per_second) : 0)
+        , next_allowed_us_(0)
+        , suppressed_(0)
+    {
+    }
+
+    Ticket acquire(LogLevel level) {
+        Ticket ticket = {false, 0};
+        if (!AsyncLogger::enabled(level)) {
+            return ticket;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t next = next_allowed_us_.load(std::memory_order_relaxed);
+        if (now < next ||
+            !next_allowed_us_.compare_exchange_strong(next, now + interval_us_,
+                                                      std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return ticket;
+        }
+        ticket.allowed = true;
+        ticket.suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return ticket;
+    }
+};
+
+// Written as a one-shot loop so it is safe inside an unbraced if/else
+#define APP_LOG(level, tag) \
+    for (bool app_log_once_ = AsyncLogger::enabled(level); app_log_once_; app_log_once_ = false) \
+        LogLine(level, tag)
+
+#define APP_LOG_DEBUG(tag) APP_LOG(LogLevel::Debug, tag)
+#define APP_LOG_INFO(tag)  APP_LOG(LogLevel::Info, tag)
+#define APP_LOG_WARN(tag)  APP_LOG(LogLevel::Warn, tag)
+#define APP_LOG_ERROR(tag) APP_LOG(LogLevel::Error, tag)
+
+// The lambda gives every expansion its own static limiter
+#define APP_LOG_RATE_LIMITED(level, tag, per_second) \
+    for (LogRateLimiter::Ticket app_log_ticket_ = ([]() -> LogRateLimiter& { \
+             static LogRateLimiter limiter(per_second); return limiter; }()).acquire(level); \
+         app_log_ticket_.allowed; app_log_ticket_.allowed = false) \
+        LogLine(level, tag, app_log_ticket_.suppressed)
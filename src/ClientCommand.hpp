@@ -0,0 +1,91 @@
+#pragma once
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Text command sent by a WebSocket client:
+//
+//   VERB key=value key=v1,v2,v3 ...
+//
+// e.g. "SUB bbox=106.9,20.7,107.1,20.8 ids=1,2 rate=5"
+struct ClientCommand {
+    std::string verb;
+    std::map<std::string, std::string> args;
+
+    static bool parse(const std::string& line, ClientCommand& cmd) {
+        std::istringstream iss(line);
+        if (!(iss >> cmd.verb)) {
+            return false;
+        }
+        for (auto& ch : cmd.verb) {
+            ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        }
+
+        cmd.args.clear();
+        std::string token;
+        while (iss >> token) {
+            auto eq = token.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                return false;
+            }
+            cmd.args[token.substr(0, eq)] = token.substr(eq + 1);
+        }
+        return true;
+    }
+
+    bool has(const std::string& key) const {
+        return args.count(key) != 0;
+    }
+
+    // Comma-separated finite numbers; false if any element does not parse
+    // (strtod alone would also accept inf and nan)
+    bool get_doubles(const std::string& key, std::vector<double>& out) const {
+        out.clear();
+        auto it = args.find(key);
+        if (it == args.end()) {
+            return false;
+        }
+        std::istringstream iss(it->second);
+        std::string item;
+        while (std::getline(iss, item, ',')) {
+            char* end = nullptr;
+            double v = std::strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0' || !std::isfinite(v)) {
+                return false;
+            }
+            out.push_back(v);
+        }
+        return !out.empty();
+    }
+
+    bool get_double(const std::string& key, double& out) const {
+        std::vector<double> values;
+        if (!get_doubles(key, values) || values.size() != 1) {
+            return false;
+        }
+        out = values[0];
+        return true;
+    }
+
+    // Whole numbers in [0, 2^32 - 1]; the range is checked before the cast,
+    // which is undefined for anything a uint32_t cannot hold
+    bool get_uints(const std::string& key, std::vector<uint32_t>& out) const {
+        std::vector<double> values;
+        if (!get_doubles(key, values)) {
+            return false;
+        }
+        out.clear();
+        for (double v : values) {
+            if (!(v >= 0.0 && v <= 4294967295.0) || v != std::floor(v)) {
+                return false;
+            }
+            out.push_back(static_cast<uint32_t>(v));
+        }
+        return true;
+    }
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "SharedCoordinateState.hpp"
+
+// Compact binary WebSocket frame, all fields little-endian:
+//
+//   header (24 bytes)
+//     0  u8[2] magic "CF"
+//     2  u8    version (1)
+//     3  u8    frame type (FrameType)
+//     4  u16   record count
+//     6  u16   record size (32)
+//     8  u32   frame sequence, per connection; a gap means frames were lost
+//    12  u32   flags (reserved, 0)
+//    16  i64   server send time, microseconds since epoch
+//
+//   record (32 bytes) x count
+//     0  u32   entity id
+//     4  u32   sample sequence
+//     8  i64   timestamp, milliseconds since epoch
+//    16  f64   longitude
+//    24  f64   latitude
+//
+// Clients opt in with the "coords.bin.v1" subprotocol or "?format=binary".
+//
+// JSON clients get the same frames as
+//   {"type":"snapshot"|"delta","seq":N,"sent":T,"updates":[{...},...]}
+// with T the server send time in microseconds since epoch.
+//
+// A connection starts with a snapshot of every known entity, followed by
+// deltas carrying only entities that moved. On a sequence gap the client
+// sends "RESYNC" and receives a fresh snapshot.
+class CoordinateCodec {
+public:
+    static const char* binary_subprotocol() {
+        return "coords.bin.v1";
+    }
+
+    enum FrameType : uint8_t {
+        FRAME_DELTA = 1,
+        FRAME_SNAPSHOT = 2
+    };
+
+    static const size_t kHeaderSize = 24;
+    static const size_t kRecordSize = 32;
+    static const uint8_t kVersion = 1;
+
+    static int64_t now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    static void encode_binary(const CoordinateData* records, size_t count,
+                              uint8_t frame_type, uint32_t frame_seq,
+                              int64_t send_time_us, std::string& out) {
+        out.resize(kHeaderSize + count * kRecordSize);
+        char* p = &out[0];
+
+        p[0] = 'C';
+        p[1] = 'F';
+        p[2] = static_cast<char>(kVersion);
+        p[3] = static_cast<char>(frame_type);
+        put_u16(p + 4, static_cast<uint16_t>(count));
+        put_u16(p + 6, static_cast<uint16_t>(kRecordSize));
+        put_u32(p + 8, frame_seq);
+        put_u32(p + 12, 0);
+        put_u64(p + 16, static_cast<uint64_t>(send_time_us));
+        p += kHeaderSize;
+
+        for (size_t i = 0; i < count; ++i, p += kRecordSize) {
+            const CoordinateData& r = records[i];
+            put_u32(p, r.entity_id);
+            put_u32(p + 4, r.sequence);
+            put_u64(p + 8, static_cast<uint64_t>(r.timestamp));
+            put_f64(p + 16, r.longitude);
+            put_f64(p + 24, r.latitude);
+        }
+    }
+
+    // Comma-separated record objects, wrapped per connection in json_frame_prefix()
+    // and json_frame_suffix()
+    static void encode_json_records(const CoordinateData* records, size_t count, std::string& out) {
+        out.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += records[i].to_json();
+        }
+    }
+
+    // Everything before the records; the frame ends with json_frame_suffix()
+    static std::string json_frame_prefix(uint8_t frame_type, uint32_t frame_seq, int64_t send_time_us) {
+        char prefix[96];
+        snprintf(prefix, sizeof(prefix), "{\"type\":\"%s\",\"seq\":%u,\"sent\":%lld,\"updates\":[",
+                 frame_type == FRAME_SNAPSHOT ? "snapshot" : "delta", frame_seq, (long long)send_time_us);
+        return prefix;
+    }
+
+    static const char* json_frame_suffix() {
+        return "]}";
+    }
+
+    // Binary frames are encoded once; each connection stamps its sequence
+    // into its own copy of the header
+    static void set_frame_sequence(char* header, uint32_t frame_seq) {
+        put_u32(header + 8, frame_seq);
+    }
+
+    // Returns false if the buffer is not a well-formed binary frame
+    static bool decode_header(const char* data, size_t size,
+                              uint8_t& frame_type, uint16_t& count,
+                              uint32_t& frame_seq, int64_t& send_time_us) {
+        if (size < kHeaderSize || data[0] != 'C' || data[1] != 'F' ||
+            static_cast<uint8_t>(data[2]) != kVersion) {
+            return false;
+        }
+        frame_type = static_cast<uint8_t>(data[3]);
+        count = get_u16(data + 4);
+        frame_seq = get_u32(data + 8);
+        send_time_us = static_cast<int64_t>(get_u64(data + 16));
+        return get_u16(data + 6) == kRecordSize &&
+               size >= kHeaderSize + count * kRecordSize;
+    }
+
+    static CoordinateData decode_record(const char* data, size_t index) {
+        const char* p = data + kHeaderSize + index * kRecordSize;
+        return CoordinateData(get_f64(p + 16), get_f64(p + 24),
+                              static_cast<int64_t>(get_u64(p + 8)),
+                              get_u32(p + 4), get_u32(p));
+    }
+
+private:
+    static void put_u16(char* p, uint16_t v) {
+        p[0] = static_cast<char>(v);
+        p[1] = static_cast<char>(v >> 8);
+    }
+
+    static void put_u32(char* p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<char>(v >> (8 * i));
+        }
+    }
+
+    static void put_u64(char* p, uint64_t v) {
+        for (int i = 0; i < 8; ++i) {
+            p[i] = static_cast<char>(v >> (8 * i));
+        }
+    }
+
+    static void put_f64(char* p, double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        put_u64(p, bits);
+    }
+
+    static uint16_t get_u16(const char* p) {
+        return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) |
+                                     (static_cast<uint8_t>(p[1]) << 8));
+    }
+
+    static uint32_t get_u32(const char* p) {
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; --i) {
+            v = (v << 8) | static_cast<uint8_t>(p[i]);
+        }
+        return v;
+    }
+
+    static uint64_t get_u64(const char* p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) {
+            v = (v << 8) | static_cast<uint8_t>(p[i]);
+        }
+        return v;
+    }
+
+    static double get_f64(const char* p) {
+        uint64_t bits = get_u64(p);
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <cmath>
 #include <chrono>
+#include <utility>
+#include "SimClock.hpp"
 
 class CoordinateGenerator {
 private:
@@ -44,10 +46,8 @@ public:
         t_ = 0.0;
     }
     
-    // Lấy timestamp hiện tại
+    // Lấy timestamp hiện tại (ms; virtual under --simulate)
     static int64_t get_timestamp() {
-        return std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()
-        ).count();
+        return SimClock::wall_ms();
     }
 };
\ No newline at end of file
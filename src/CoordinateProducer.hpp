@@ -1,106 +1,165 @@
 #pragma once
 #define ASIO_STANDALONE
 #include <asio.hpp>
+#include <algorithm>
 #include <memory>
 #include <atomic>
 #include <chrono>
-#include <iostream>
+#include <cstdio>
+#include <string>
+#include "AsyncLogger.hpp"
+#include "Metrics.hpp"
+#include "PrecisionTicker.hpp"
 #include "SharedCoordinateState.hpp"
 #include "CoordinateGenerator.hpp"
+#include "TimingWheel.hpp"
+#include "Tracer.hpp"
 
 class CoordinateProducer {
 private:
-    asio::io_context io_context_;
-    asio::steady_timer timer_;
+    asio::io_context own_io_context_;
+    std::unique_ptr<TimingWheel> own_wheel_;
+    TimingWheel& wheel_;  // *own_wheel_ unless one was shared
+    TimingWheel::TaskId task_;
     std::shared_ptr<SharedCoordinateState> state_;
+    std::chrono::microseconds period_;
     CoordinateGenerator generator_;
-    
-    std::chrono::steady_clock::time_point next_deadline_;
-    std::chrono::milliseconds period_;
-    
+    uint32_t log_every_;  // samples between progress lines (~every 2 s at high rates)
+    std::unique_ptr<PrecisionTicker> ticker_;  // high-rate mode, see enable_precise()
+    std::string jitter_csv_;
+
     std::atomic<bool> running_;
     std::atomic<uint32_t> sequence_;
-    
-    void schedule_next() {
-        if (!running_.load()) {
-            return;
+    Metrics::Counter& generated_total_;
+
+    static TimingWheel& make_own_wheel(std::unique_ptr<TimingWheel>& own, asio::io_context& io) {
+        own.reset(new TimingWheel(io));
+        return *own;
+    }
+
+    void tick() {
+        uint32_t seq = sequence_.fetch_add(1) + 1;
+
+        // Generate tọa độ mới
+        std::pair<double, double> coords;
+        int64_t timestamp;
+        {
+            TRACE_SPAN_SEQ("generate", seq);
+            coords = generator_.get_next_coordinate();
+            timestamp = CoordinateGenerator::get_timestamp();
+        }
+
+        // Update shared state
+        state_->update(coords.first, coords.second, timestamp, seq);
+        generated_total_.inc();
+
+        // Log định kỳ
+        if (seq % log_every_ == 0) {
+            APP_LOG_INFO("CoordinateProducer") << "Generated " << seq
+                     << " samples. Latest: [" << coords.first
+                     << ", " << coords.second << "]";
         }
-        
-        timer_.expires_at(next_deadline_);
-        timer_.async_wait([this](const websocketpp::lib::error_code& ec) {
-            if (ec) {
-                if (ec != asio::error::operation_aborted) {
-                    std::cerr << "[CoordinateProducer] Timer error: " << ec.message() << std::endl;
-                }
-                return;
-            }
-            
-            // Generate tọa độ mới
-            auto coords = generator_.get_next_coordinate();
-            auto timestamp = CoordinateGenerator::get_timestamp();
-            uint32_t seq = sequence_.fetch_add(1) + 1;
-            
-            // Update shared state
-            state_->update(coords.first, coords.second, timestamp, seq);
-            
-            // Log định kỳ
-            if (seq % 100 == 0) {
-                std::cout << "[CoordinateProducer] Generated " << seq 
-                         << " samples. Latest: [" << coords.first 
-                         << ", " << coords.second << "]" << std::endl;
-            }
-            
-            // Schedule next tick
-            next_deadline_ += period_;
-            schedule_next();
-        });
     }
-    
+
 public:
     CoordinateProducer(std::shared_ptr<SharedCoordinateState> state,
-                      std::chrono::milliseconds period = std::chrono::milliseconds(20),
+                      std::chrono::microseconds period = std::chrono::milliseconds(20),
                       double center_lon = 107.02243,
-                      double center_lat = 20.76300)
-        : timer_(io_context_)
+                      double center_lat = 20.76300,
+                      TimingWheel* shared_wheel = nullptr)
+        : wheel_(shared_wheel ? *shared_wheel : make_own_wheel(own_wheel_, own_io_context_))
+        , task_(0)
         , state_(state)
-        , generator_(center_lon, center_lat)
         , period_(period)
+        // Step scaled to the rate so the trajectory speed does not depend on it
+        , generator_(center_lon, center_lat, 0.05, 0.01 * period.count() / 20000.0)
+        , log_every_(std::max<uint32_t>(100, static_cast<uint32_t>(2000000 / std::max<int64_t>(1, period.count()))))
         , running_(false)
         , sequence_(0)
+        , generated_total_(Metrics::counter("messenger_samples_generated_total",
+                                            "Coordinates generated by the producer"))
     {
     }
-    
+
     void start() {
         if (running_.exchange(true)) {
             return; // Already running
         }
-        
-        std::cout << "[CoordinateProducer] Starting with period: " 
-                 << period_.count() << "ms (~" 
-                 << (1000.0 / period_.count()) << "Hz)" << std::endl;
-        
-        next_deadline_ = std::chrono::steady_clock::now() + period_;
-        schedule_next();
+
+        APP_LOG_INFO("CoordinateProducer") << "Starting with period: "
+                 << period_.count() << "us (~"
+                 << (1e6 / period_.count()) << "Hz)";
+
+        task_ = wheel_.schedule_periodic("producer", period_, [this]() { tick(); });
     }
-    
+
     void stop() {
-        std::cout << "[CoordinateProducer] Stopping... Total generated: " 
-                 << sequence_.load() << std::endl;
+        APP_LOG_INFO("CoordinateProducer") << "Stopping... Total generated: "
+                 << sequence_.load();
         running_.store(false);
-        timer_.cancel();
-        io_context_.stop();
+        if (ticker_) {
+            ticker_->stop();
+            return;
+        }
+        TimingWheel::TaskStats stats;
+        if (wheel_.stats_of(task_, stats)) {
+            APP_LOG_INFO("CoordinateProducer") << "Tick jitter: " << TimingWheel::format(stats);
+        }
+        wheel_.cancel(task_);
+        // A shared wheel and its io_context belong to the caller
+        if (own_wheel_) {
+            own_wheel_->stop();
+            own_io_context_.stop();
+        }
+    }
+
+    // High-rate mode (1-10 kHz): run() ticks from a PrecisionTicker on the
+    // calling thread instead of the timing wheel. The period is the one
+    // given to the constructor. Call before run().
+    void enable_precise(std::chrono::microseconds spin, int cpu = -1, int fifo_priority = 0,
+                        const std::string& jitter_csv = "") {
+        PrecisionTicker::Options options;
+        options.period = period_;
+        options.spin = spin;
+        options.cpu = cpu;
+        options.fifo_priority = fifo_priority;
+        ticker_.reset(new PrecisionTicker(options));
+        jitter_csv_ = jitter_csv;
     }
-    
+
+    // Blocks on the producer's io_context (or ticker). With a shared wheel
+    // call start() instead and let the owner run it.
     void run() {
-        start();
-        io_context_.run();
+        if (!ticker_) {
+            start();
+            own_io_context_.run();
+            return;
+        }
+        if (running_.exchange(true)) {
+            return;
+        }
+        APP_LOG_INFO("CoordinateProducer") << "Starting precise ticks every "
+                 << period_.count() << "us (~" << (1e6 / period_.count()) << "Hz)";
+        ticker_->run([this]() { tick(); });
+
+        APP_LOG_INFO("CoordinateProducer") << "Tick jitter: "
+                 << ticker_->lateness_ns().summary("ns late") << ", missed " << ticker_->missed();
+        if (!jitter_csv_.empty()) {
+            FILE* out = fopen(jitter_csv_.c_str(), "w");
+            if (out) {
+                ticker_->lateness_ns().write_csv(out);
+                fclose(out);
+            } else {
+                APP_LOG_WARN("CoordinateProducer") << "Cannot write " << jitter_csv_;
+            }
+        }
     }
-    
+
     bool is_running() const {
         return running_.load();
     }
-    
+
     uint32_t get_sequence() const {
         return sequence_.load();
     }
-};
\ No newline at end of file
+};
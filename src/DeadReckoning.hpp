@@ -0,0 +1,166 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "SharedCoordinateState.hpp"
+#include "SpatialIndex.hpp"
+
+// Dead reckoning: both ends predict an entity's position from the last sample
+// sent and its velocity (constant-velocity model), so the publisher only has
+// to send when reality drifts away from that prediction.
+
+// Degrees per second
+struct GeoVelocity {
+    double lon_per_s;
+    double lat_per_s;
+
+    GeoVelocity() : lon_per_s(0.0), lat_per_s(0.0) {}
+
+    bool moving() const {
+        return lon_per_s != 0.0 || lat_per_s != 0.0;
+    }
+};
+
+inline CoordinateData predict_position(const CoordinateData& from, const GeoVelocity& v, int64_t at_ms) {
+    double dt = (at_ms - from.timestamp) / 1000.0;
+    return CoordinateData(from.longitude + v.lon_per_s * dt, from.latitude + v.lat_per_s * dt,
+                          at_ms, from.sequence, from.entity_id);
+}
+
+// Publisher side. observe() every new position; it returns true when the
+// sample must go out: new entity, prediction off by more than tolerance_m,
+// or nothing sent for heartbeat_ms. Velocity is a smoothed finite difference
+// of the observed positions. Not thread-safe.
+class DeadReckoning {
+private:
+    struct Track {
+        CoordinateData sent;      // what the receivers extrapolate from
+        GeoVelocity sent_velocity;
+        CoordinateData observed;  // previous observation
+        GeoVelocity velocity;     // current estimate
+    };
+
+    double tolerance_m_;
+    int64_t heartbeat_ms_;
+    std::unordered_map<uint32_t, Track> tracks_;
+    uint64_t sent_;
+    uint64_t suppressed_;
+
+public:
+    DeadReckoning(double tolerance_m, uint32_t heartbeat_ms)
+        : tolerance_m_(tolerance_m)
+        , heartbeat_ms_(std::max<uint32_t>(1, heartbeat_ms))
+        , sent_(0)
+        , suppressed_(0)
+    {
+    }
+
+    // On true, `velocity` is what to send along with the sample
+    bool observe(const CoordinateData& data, GeoVelocity& velocity) {
+        auto result = tracks_.insert(std::make_pair(data.entity_id, Track()));
+        Track& track = result.first->second;
+        if (!result.second) {
+            double dt = (data.timestamp - track.observed.timestamp) / 1000.0;
+            if (dt > 0.0) {
+                // Half old estimate, half new difference: rides out GPS noise
+                // without lagging far behind a turn
+                track.velocity.lon_per_s = 0.5 * track.velocity.lon_per_s +
+                                           0.5 * (data.longitude - track.observed.longitude) / dt;
+                track.velocity.lat_per_s = 0.5 * track.velocity.lat_per_s +
+                                           0.5 * (data.latitude - track.observed.latitude) / dt;
+            }
+        }
+        track.observed = data;
+
+        if (!result.second && data.timestamp - track.sent.timestamp < heartbeat_ms_) {
+            CoordinateData predicted = predict_position(track.sent, track.sent_velocity, data.timestamp);
+            if (SpatialIndex::distance_m(predicted.longitude, predicted.latitude,
+                                         data.longitude, data.latitude) <= tolerance_m_) {
+                ++suppressed_;
+                return false;
+            }
+        }
+        track.sent = data;
+        track.sent_velocity = track.velocity;
+        velocity = track.velocity;
+        ++sent_;
+        return true;
+    }
+
+    double tolerance_m() const {
+        return tolerance_m_;
+    }
+
+    uint64_t sent() const {
+        return sent_;
+    }
+
+    uint64_t suppressed() const {
+        return suppressed_;
+    }
+};
+
+// Subscriber side: the last sample and velocity of every moving entity, to
+// fill in the positions the publisher did not send. Tracks older than
+// horizon_ms are dropped, since the publisher is probably gone. Thread-safe.
+class DeadReckoningTracks {
+private:
+    struct Track {
+        CoordinateData data;
+        GeoVelocity velocity;
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, Track> tracks_;
+    int64_t horizon_ms_;
+
+public:
+    explicit DeadReckoningTracks(uint32_t horizon_ms = 3000)
+        : horizon_ms_(horizon_ms)
+    {
+    }
+
+    void set_horizon(uint32_t horizon_ms) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        horizon_ms_ = horizon_ms;
+    }
+
+    void on_sample(const CoordinateData& data, const GeoVelocity& velocity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!velocity.moving() || horizon_ms_ == 0) {
+            tracks_.erase(data.entity_id);
+            return;
+        }
+        Track& track = tracks_[data.entity_id];
+        track.data = data;
+        track.velocity = velocity;
+    }
+
+    // Calls f(predicted) for every track, at now_ms. Predictions carry
+    // sequence 0: they are not samples from the source. f runs under the
+    // lock, so a sample that arrives meanwhile waits in on_sample() and is
+    // applied after the prediction, never before it; f must not call back in.
+    template <typename F>
+    void extrapolate(int64_t now_ms, F f) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = tracks_.begin(); it != tracks_.end();) {
+            int64_t age = now_ms - it->second.data.timestamp;
+            if (age > horizon_ms_) {
+                it = tracks_.erase(it);
+                continue;
+            }
+            if (age > 0) {
+                CoordinateData predicted = predict_position(it->second.data, it->second.velocity, now_ms);
+                predicted.sequence = 0;
+                f(predicted);
+            }
+            ++it;
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tracks_.size();
+    }
+};
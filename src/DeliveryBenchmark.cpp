@@ -0,0 +1,296 @@
+#include "DeliveryBenchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <fastdds/dds/core/status/SubscriptionMatchedStatus.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+
+#include "Messenger.hpp"
+#include "MessengerPubSubTypes.hpp"
+#include "SharedParticipant.hpp"
+
+using namespace eprosima::fastdds::dds;
+
+namespace {
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+DeliveryBenchmark::DeliveryBenchmark(
+        int domain_id,
+        uint32_t samples,
+        uint32_t rate_hz,
+        uint32_t payload_bytes,
+        const TransportProfile& profile)
+    : domain_id_(domain_id)
+    , samples_(samples)
+    , rate_hz_(rate_hz)
+    , payload_bytes_(payload_bytes)
+    , profile_(profile)
+    , last_received_ns_(0)
+    , burst_received_(0)
+    , burst_last_ns_(0)
+    , matched_(0)
+    , received_(0)
+{
+}
+
+DeliveryBenchmark::Result DeliveryBenchmark::run(
+        const std::string& mode)
+{
+    if (mode != "intra" && mode != "shm" && mode != "udp" && mode != "tcp")
+    {
+        throw std::runtime_error("Unknown delivery mode: " + mode);
+    }
+
+    sent_ns_.assign(samples_, 0);
+    latency_ns_.reset();
+    last_received_ns_ = 0;
+    burst_received_ = 0;
+    burst_last_ns_ = 0;
+    matched_ = 0;
+    received_ = 0;
+
+    // Library settings only change while no participant exists
+    if (!SharedParticipant::set_intraprocess(mode == "intra"))
+    {
+        throw std::runtime_error("Cannot change intra-process delivery setting");
+    }
+
+    std::shared_ptr<SharedParticipant> writer_side;
+    std::shared_ptr<SharedParticipant> reader_side;
+    if (mode == "intra")
+    {
+        writer_side = std::make_shared<SharedParticipant>(domain_id_, "Messenger::Message_bench_participant",
+                        profile_.with_kind("default").participant_qos(true));
+        reader_side = writer_side;
+    }
+    else
+    {
+        // The writer side listens when the transport is TCP
+        TransportProfile profile = profile_.with_kind(mode);
+        writer_side = std::make_shared<SharedParticipant>(domain_id_, "Messenger::Message_bench_writer",
+                        profile.participant_qos(true));
+        reader_side = std::make_shared<SharedParticipant>(domain_id_, "Messenger::Message_bench_reader",
+                        profile.participant_qos(false));
+    }
+
+    TypeSupport type(new Messenger::MessagePubSubType());
+    Topic* writer_topic = writer_side->topic("Movie Discussion List", type);
+    Topic* reader_topic = reader_side->topic("Movie Discussion List", type);
+
+    Publisher* publisher = writer_side->get()->create_publisher(PUBLISHER_QOS_DEFAULT);
+    Subscriber* subscriber = reader_side->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+    if (publisher == nullptr || subscriber == nullptr)
+    {
+        throw std::runtime_error("Benchmark publisher/subscriber initialization failed");
+    }
+
+    // Data sharing would bypass the transport under test. KEEP_ALL with a
+    // bounded history makes the burst phase block instead of dropping.
+    DataWriterQos writer_qos = DATAWRITER_QOS_DEFAULT;
+    writer_qos.reliability().kind = ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+    writer_qos.reliability().max_blocking_time = Duration_t(1, 0);
+    writer_qos.history().kind = HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS;
+    writer_qos.resource_limits().max_samples = 1000;
+    writer_qos.resource_limits().max_instances = 1;
+    writer_qos.resource_limits().max_samples_per_instance = 1000;
+    writer_qos.data_sharing().off();
+    DataWriter* writer = publisher->create_datawriter(writer_topic, writer_qos);
+
+    DataReaderQos reader_qos = DATAREADER_QOS_DEFAULT;
+    reader_qos.reliability().kind = ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+    reader_qos.history().kind = HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS;
+    reader_qos.data_sharing().off();
+    DataReader* reader = subscriber->create_datareader(reader_topic, reader_qos, this, StatusMask::all());
+    if (writer == nullptr || reader == nullptr)
+    {
+        throw std::runtime_error("Benchmark DataWriter/DataReader initialization failed");
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_for(lock, std::chrono::seconds(10), [this]() { return matched_ > 0; }))
+        {
+            throw std::runtime_error("Benchmark endpoints did not match over " + mode);
+        }
+    }
+    // The writer may see the match a moment after the reader
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    Messenger::Message sample;
+    sample.from("DeliveryBenchmark");
+    sample.subject(mode);
+    sample.subject_id(1);
+    sample.text(std::string(payload_bytes_, 'x'));
+
+    std::chrono::nanoseconds period(1000000000LL / std::max<uint32_t>(1, rate_hz_));
+    auto next = std::chrono::steady_clock::now();
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < samples_; ++i)
+    {
+        sample.count(static_cast<int32_t>(i));
+        sent_ns_[i] = now_ns();
+        if (RETCODE_OK == writer->write(&sample))
+        {
+            sent++;
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+
+    Result result;
+    result.mode = mode;
+    result.sent = sent;
+    result.payload_bytes = payload_bytes_;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::seconds(2), [this, sent]() { return received_ >= sent; });
+        result.received = received_;
+        result.seconds = received_ ? (last_received_ns_ - sent_ns_[0]) / 1e9 : 0.0;
+        result.latency_ns = latency_ns_;
+    }
+
+    // Burst: as fast as the writer's history lets us
+    uint32_t burst_sent = 0;
+    int64_t burst_start_ns = now_ns();
+    for (uint32_t i = 0; i < samples_; ++i)
+    {
+        sample.count(static_cast<int32_t>(samples_ + i));
+        if (RETCODE_OK == writer->write(&sample))
+        {
+            burst_sent++;
+        }
+    }
+    result.burst_sent = burst_sent;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::seconds(5), [this, burst_sent]() { return burst_received_ >= burst_sent; });
+        result.burst_received = burst_received_;
+        result.burst_seconds = burst_received_ ? (burst_last_ns_ - burst_start_ns) / 1e9 : 0.0;
+    }
+
+    // Stop callbacks before the endpoints go
+    reader->set_listener(nullptr);
+    return result;
+}
+
+void DeliveryBenchmark::on_data_available(
+        DataReader* reader)
+{
+    Messenger::Message sample;
+    SampleInfo info;
+    while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+    {
+        if (!info.valid_data)
+        {
+            continue;
+        }
+        int64_t now = now_ns();
+        uint32_t index = static_cast<uint32_t>(sample.count());
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index < sent_ns_.size())
+        {
+            latency_ns_.record(now - sent_ns_[index]);
+            last_received_ns_ = now;
+            received_++;
+        }
+        else
+        {
+            burst_last_ns_ = now;
+            burst_received_++;
+        }
+        cv_.notify_all();
+    }
+}
+
+void DeliveryBenchmark::on_subscription_matched(
+        DataReader* /*reader*/,
+        const SubscriptionMatchedStatus& info)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    matched_ = info.current_count;
+    cv_.notify_all();
+}
+
+std::string DeliveryBenchmark::format(
+        const Result& result)
+{
+    std::ostringstream line;
+    char rate[96];
+    double burst_rate = result.burst_seconds > 0.0 ? result.burst_received / result.burst_seconds : 0.0;
+    snprintf(rate, sizeof(rate), "%.0f samples/s, %.1f MB/s", burst_rate,
+             burst_rate * result.payload_bytes / 1e6);
+    line << result.mode << ": paced " << result.received << "/" << result.sent
+         << ", latency " << result.latency_ns.summary("ns") << "; burst "
+         << result.burst_received << "/" << result.burst_sent << ", " << rate;
+    return line.str();
+}
+
+int DeliveryBenchmark::main(
+        const AppOptions& options)
+{
+    std::string modes = options.get_string("modes", "intra,shm,udp,tcp");
+    uint32_t samples = std::max<uint32_t>(1, options.get_uint("samples", 10000));
+    uint32_t rate_hz = options.get_uint("rate", 1000);
+    uint32_t payload = options.get_uint("payload", 64);
+    int domain_id = static_cast<int>(options.get_uint("domain", 42));
+    TransportProfile profile;
+    try
+    {
+        profile = TransportProfile::from_options(options);
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "   DDS DELIVERY BENCHMARK" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << samples << " samples at " << rate_hz << " Hz, then " << samples << " unpaced, "
+              << payload << " byte payload, domain " << domain_id << std::endl;
+
+    DeliveryBenchmark bench(domain_id, samples, rate_hz, payload, profile);
+    std::istringstream list(modes);
+    std::string mode;
+    int ret = EXIT_SUCCESS;
+    while (std::getline(list, mode, ','))
+    {
+        try
+        {
+            if (mode != "intra")
+            {
+                std::cout << "[" << profile.with_kind(mode).describe() << "]" << std::endl;
+            }
+            std::cout << bench.format(bench.run(mode)) << std::endl;
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cout << mode << ": " << e.what() << std::endl;
+            ret = EXIT_FAILURE;
+        }
+    }
+    std::cout << "========================================" << std::endl;
+    return ret;
+}
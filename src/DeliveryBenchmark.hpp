@@ -0,0 +1,84 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+
+#include "AppOptions.hpp"
+#include "LatencyHistogram.hpp"
+#include "TransportProfile.hpp"
+
+// Write -> on_data_available latency of the Messenger topic within one
+// process, for each way a sample can get from writer to reader:
+//   intra - one participant, Fast DDS intra-process delivery
+//   shm   - two participants, shared-memory transport only
+//   udp   - two participants, UDPv4 bound to 127.0.0.1
+//   tcp   - two participants, TCPv4 over 127.0.0.1
+// Transport settings (segment size, socket buffers, port) come from a
+// TransportProfile. Each mode runs two phases: samples paced at a fixed
+// rate, so the latency is per sample and not the depth of a queue; then an
+// unpaced burst through a blocking KEEP_ALL writer for throughput.
+class DeliveryBenchmark : public eprosima::fastdds::dds::DataReaderListener
+{
+public:
+
+    struct Result
+    {
+        std::string mode;
+        uint32_t sent;
+        uint32_t received;
+        double seconds;             // first write to last delivery
+        LatencyHistogram latency_ns;
+        uint32_t burst_sent;
+        uint32_t burst_received;
+        double burst_seconds;
+        uint32_t payload_bytes;
+    };
+
+    DeliveryBenchmark(
+            int domain_id,
+            uint32_t samples,
+            uint32_t rate_hz,
+            uint32_t payload_bytes,
+            const TransportProfile& profile = TransportProfile());
+
+    //! One mode; throws std::runtime_error on unknown modes or DDS failures
+    Result run(
+            const std::string& mode);
+
+    void on_data_available(
+            eprosima::fastdds::dds::DataReader* reader) override;
+
+    void on_subscription_matched(
+            eprosima::fastdds::dds::DataReader* reader,
+            const eprosima::fastdds::dds::SubscriptionMatchedStatus& info) override;
+
+    //! `Messenger bench-delivery [--modes intra,shm,udp,tcp] [--samples N] [--rate HZ] [--payload BYTES]
+    //! [transport options]`
+    static int main(
+            const AppOptions& options);
+
+    static std::string format(
+            const Result& result);
+
+private:
+
+    int domain_id_;
+    uint32_t samples_;
+    uint32_t rate_hz_;
+    uint32_t payload_bytes_;
+    TransportProfile profile_;
+
+    std::vector<int64_t> sent_ns_;  // by sample count; written before write(), read in the listener
+    LatencyHistogram latency_ns_;   // guarded by mutex_, like the fields below
+    int64_t last_received_ns_;
+    uint32_t burst_received_;       // samples with a count past the paced phase
+    int64_t burst_last_ns_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int32_t matched_;
+    uint32_t received_;
+};
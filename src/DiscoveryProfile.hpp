@@ -0,0 +1,164 @@
+#pragma once
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fastdds/dds/core/Time_t.hpp>
+#include <fastdds/dds/domain/qos/DomainParticipantQos.hpp>
+#include <fastdds/rtps/attributes/RTPSParticipantAttributes.hpp>
+#include <fastdds/rtps/common/Locator.hpp>
+#include <fastdds/utils/IPLocator.hpp>
+
+#include "AppOptions.hpp"
+
+// How a participant finds the others, from the command line:
+//   --peers HOST[:PORT],...       unicast initial peers; without a port the
+//                                 well-known ports of the first few
+//                                 participants of the domain are tried
+//   --discovery-server HOST:PORT  discover through a Fast DDS discovery
+//                                 server instead of multicast SPDP
+//                                 (`Messenger discovery-server` runs one)
+//   --announce-ms N               participant announcement period
+//   --initial-announcements N     fast announcements right after start...
+//   --initial-announce-ms N       ...and their period
+//   --lease-ms N                  how long a silent participant stays alive
+// Anything not given keeps the Fast DDS default.
+class DiscoveryProfile {
+public:
+    static const uint16_t kDefaultServerPort = 11811;
+
+private:
+    std::vector<std::pair<std::string, uint16_t>> peers_;
+    std::string server_host_;
+    uint16_t server_port_;
+    uint32_t announce_ms_;
+    uint32_t initial_announcements_;
+    uint32_t initial_announce_ms_;
+    uint32_t lease_ms_;
+
+    static std::pair<std::string, uint16_t> parse_address(const std::string& text, uint16_t default_port) {
+        std::string host = text;
+        uint16_t port = default_port;
+        auto colon = text.find(':');
+        if (colon != std::string::npos) {
+            host = text.substr(0, colon);
+            try {
+                port = static_cast<uint16_t>(std::stoul(text.substr(colon + 1)));
+            } catch (const std::exception&) {
+                throw std::runtime_error("Invalid address: " + text);
+            }
+        }
+        if (host.empty() || !eprosima::fastdds::rtps::IPLocator::isIPv4(host)) {
+            throw std::runtime_error("Expected an IPv4 address: " + text);
+        }
+        return std::make_pair(host, port);
+    }
+
+    static eprosima::fastdds::rtps::Locator_t udp_locator(const std::string& host, uint16_t port) {
+        eprosima::fastdds::rtps::Locator_t locator;
+        locator.kind = LOCATOR_KIND_UDPv4;
+        eprosima::fastdds::rtps::IPLocator::setIPv4(locator, host);
+        locator.port = port;
+        return locator;
+    }
+
+    static eprosima::fastdds::dds::Duration_t millis(uint32_t ms) {
+        return eprosima::fastdds::dds::Duration_t(static_cast<int32_t>(ms / 1000), (ms % 1000) * 1000000u);
+    }
+
+public:
+    DiscoveryProfile()
+        : server_port_(kDefaultServerPort)
+        , announce_ms_(0)
+        , initial_announcements_(0)
+        , initial_announce_ms_(0)
+        , lease_ms_(0)
+    {}
+
+    static DiscoveryProfile from_options(const AppOptions& options) {
+        DiscoveryProfile profile;
+        std::istringstream peers(options.get_string("peers"));
+        std::string peer;
+        while (std::getline(peers, peer, ',')) {
+            if (!peer.empty()) {
+                profile.peers_.push_back(parse_address(peer, 0));
+            }
+        }
+        if (options.has("discovery-server")) {
+            auto server = parse_address(options.get_string("discovery-server"), kDefaultServerPort);
+            profile.server_host_ = server.first;
+            profile.server_port_ = server.second;
+        }
+        profile.announce_ms_ = options.get_uint("announce-ms", 0);
+        profile.initial_announcements_ = options.get_uint("initial-announcements", 0);
+        profile.initial_announce_ms_ = options.get_uint("initial-announce-ms", 0);
+        profile.lease_ms_ = options.get_uint("lease-ms", 0);
+        return profile;
+    }
+
+    bool uses_server() const {
+        return !server_host_.empty();
+    }
+
+    // Discovery settings on top of `pqos` (usually from a TransportProfile)
+    eprosima::fastdds::dds::DomainParticipantQos apply(eprosima::fastdds::dds::DomainParticipantQos pqos) const {
+        auto& builtin = pqos.wire_protocol().builtin;
+        for (const auto& peer : peers_) {
+            builtin.initialPeersList.push_back(udp_locator(peer.first, peer.second));
+        }
+        if (uses_server()) {
+            builtin.discovery_config.discoveryProtocol = eprosima::fastdds::rtps::DiscoveryProtocol::CLIENT;
+            builtin.discovery_config.m_DiscoveryServers.push_back(udp_locator(server_host_, server_port_));
+        }
+        if (announce_ms_ != 0) {
+            builtin.discovery_config.leaseDuration_announcementperiod = millis(announce_ms_);
+        }
+        if (initial_announcements_ != 0) {
+            builtin.discovery_config.initial_announcements.count = initial_announcements_;
+        }
+        if (initial_announce_ms_ != 0) {
+            builtin.discovery_config.initial_announcements.period = millis(initial_announce_ms_);
+        }
+        if (lease_ms_ != 0) {
+            builtin.discovery_config.leaseDuration = millis(lease_ms_);
+        }
+        return pqos;
+    }
+
+    // The discovery server itself, listening on the --discovery-server address
+    eprosima::fastdds::dds::DomainParticipantQos server_qos(eprosima::fastdds::dds::DomainParticipantQos pqos) const {
+        auto& builtin = pqos.wire_protocol().builtin;
+        builtin.discovery_config.discoveryProtocol = eprosima::fastdds::rtps::DiscoveryProtocol::SERVER;
+        builtin.metatrafficUnicastLocatorList.push_back(
+            udp_locator(uses_server() ? server_host_ : "127.0.0.1", server_port_));
+        if (lease_ms_ != 0) {
+            builtin.discovery_config.leaseDuration = millis(lease_ms_);
+        }
+        return pqos;
+    }
+
+    // e.g. "server 127.0.0.1:11811, announce 500 ms"
+    std::string describe() const {
+        std::ostringstream out;
+        if (uses_server()) {
+            out << "server " << server_host_ << ":" << server_port_;
+        } else {
+            out << "simple (multicast)";
+        }
+        if (!peers_.empty()) {
+            out << ", " << peers_.size() << " initial peer(s)";
+        }
+        if (announce_ms_ != 0) {
+            out << ", announce " << announce_ms_ << " ms";
+        }
+        if (initial_announcements_ != 0 || initial_announce_ms_ != 0) {
+            out << ", initial announcements " << initial_announcements_ << " x " << initial_announce_ms_ << " ms";
+        }
+        if (lease_ms_ != 0) {
+            out << ", lease " << lease_ms_ << " ms";
+        }
+        return out.str();
+    }
+};
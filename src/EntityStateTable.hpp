@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "SharedCoordinateState.hpp"
+
+// Latest known state of every entity, thread-safe. Used to build snapshots
+// for late joiners and to tell whether an update is actually a change.
+class EntityStateTable {
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, CoordinateData> entities_;
+
+public:
+    // Returns true if the entity is new or its position moved
+    bool update(const CoordinateData& data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto result = entities_.insert(std::make_pair(data.entity_id, data));
+        if (result.second) {
+            return true;
+        }
+        CoordinateData& current = result.first->second;
+        bool moved = current.longitude != data.longitude || current.latitude != data.latitude;
+        current = data;
+        return moved;
+    }
+
+    bool get(uint32_t entity_id, CoordinateData& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entities_.find(entity_id);
+        if (it == entities_.end()) {
+            return false;
+        }
+        out = it->second;
+        return true;
+    }
+
+    template <typename Predicate>
+    void snapshot(std::vector<CoordinateData>& out, Predicate keep) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.clear();
+        out.reserve(entities_.size());
+        for (const auto& entry : entities_) {
+            if (keep(entry.second)) {
+                out.push_back(entry.second);
+            }
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entities_.size();
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// Uniform longitude/latitude grid. Cells are identified by a packed 64-bit
+// key so they can be used directly as hash map keys.
+class GeoGrid {
+private:
+    double cell_deg_;
+
+public:
+    explicit GeoGrid(double cell_deg = 0.25)
+        : cell_deg_(cell_deg > 0.0 ? cell_deg : 0.25)
+    {
+    }
+
+    double cell_deg() const {
+        return cell_deg_;
+    }
+
+    int32_t column(double lon) const {
+        return static_cast<int32_t>(std::floor((lon + 180.0) / cell_deg_));
+    }
+
+    int32_t row(double lat) const {
+        return static_cast<int32_t>(std::floor((lat + 90.0) / cell_deg_));
+    }
+
+    static uint64_t key(int32_t column, int32_t row) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32) |
+               static_cast<uint32_t>(row);
+    }
+
+    uint64_t cell_of(double lon, double lat) const {
+        return key(column(lon), row(lat));
+    }
+
+    // Number of cells touched by a bounding box
+    uint64_t cell_count(double min_lon, double min_lat, double max_lon, double max_lat) const {
+        return static_cast<uint64_t>(column(max_lon) - column(min_lon) + 1) *
+               static_cast<uint64_t>(row(max_lat) - row(min_lat) + 1);
+    }
+
+    template <typename F>
+    void for_each_cell(double min_lon, double min_lat, double max_lon, double max_lat, F f) const {
+        int32_t c1 = column(max_lon);
+        int32_t r1 = row(max_lat);
+        for (int32_t c = column(min_lon); c <= c1; ++c) {
+            for (int32_t r = row(min_lat); r <= r1; ++r) {
+                f(key(c, r));
+            }
+        }
+    }
+};
@@ -0,0 +1,429 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.hpp"
+#include "SharedCoordinateState.hpp"
+
+// Hours of per-entity coordinate history, compressed in memory.
+//
+// Each entity's points go into blocks of kBlockPoints, one column at a time
+// per point (Gorilla, Pelkonen et al. 2015):
+//   timestamp   delta-of-delta: '0' when the interval repeats, else a
+//               prefix code and 7/9/12/64 bits
+//   lon, lat    XOR with the previous value: '0' when equal, '10' + the
+//               meaningful bits when they fit the previous leading/trailing
+//               zero window, else '11' + 5-bit leading zeros + 6-bit length
+//   sequence    '0' when it is the previous + 1, else '1' + 32 bits
+// Full blocks are sealed and trimmed; a per-entity index of block time
+// ranges lets range scans skip straight to the first block that overlaps.
+// Blocks entirely older than the retention are dropped, and once a minute
+// (in sample time) a sweep also drops the history of entities that stopped
+// reporting. Thread-safe.
+class HistoryStore {
+public:
+    static const size_t kBlockPoints = 1024;
+    static const int64_t kSweepIntervalMs = 60000;
+
+private:
+    class BitWriter {
+    private:
+        std::vector<uint64_t> words_;
+        size_t bits_;
+
+    public:
+        BitWriter() : bits_(0) {}
+
+        // Low `count` bits of value, most significant first
+        void write(uint64_t value, unsigned count) {
+            while (count > 0) {
+                size_t offset = bits_ & 63;
+                if (offset == 0) {
+                    words_.push_back(0);
+                }
+                unsigned room = 64 - static_cast<unsigned>(offset);
+                unsigned n = count < room ? count : room;
+                uint64_t chunk = (value >> (count - n)) & (n == 64 ? ~0ULL : ((1ULL << n) - 1));
+                words_.back() |= chunk << (room - n);
+                bits_ += n;
+                count -= n;
+            }
+        }
+
+        void shrink() {
+            words_.shrink_to_fit();
+        }
+
+        const std::vector<uint64_t>& words() const {
+            return words_;
+        }
+
+        size_t bytes() const {
+            return words_.capacity() * sizeof(uint64_t);
+        }
+    };
+
+    class BitReader {
+    private:
+        const std::vector<uint64_t>& words_;
+        size_t bit_;
+
+    public:
+        explicit BitReader(const std::vector<uint64_t>& words) : words_(words), bit_(0) {}
+
+        uint64_t read(unsigned count) {
+            uint64_t value = 0;
+            while (count > 0) {
+                size_t offset = bit_ & 63;
+                unsigned room = 64 - static_cast<unsigned>(offset);
+                unsigned n = count < room ? count : room;
+                uint64_t chunk = (words_[bit_ >> 6] >> (room - n)) & (n == 64 ? ~0ULL : ((1ULL << n) - 1));
+                value = (n == 64 ? 0 : value << n) | chunk;
+                bit_ += n;
+                count -= n;
+            }
+            return value;
+        }
+
+        bool bit() {
+            return read(1) != 0;
+        }
+    };
+
+    // Previous value and zero window of one XOR-compressed column
+    struct XorState {
+        uint64_t previous;
+        unsigned leading;
+        unsigned trailing;
+
+        XorState() : previous(0), leading(64), trailing(0) {}
+    };
+
+    // Running state shared by the encoder and the decoder
+    struct Cursor {
+        int64_t timestamp;
+        int64_t delta;
+        uint32_t sequence;
+        XorState lon;
+        XorState lat;
+
+        Cursor() : timestamp(0), delta(0), sequence(0) {}
+    };
+
+    struct Block {
+        BitWriter bits;
+        Cursor cursor;  // after the last point, to append
+        size_t count;
+        int64_t first_ms;
+        int64_t last_ms;
+
+        Block() : count(0), first_ms(0), last_ms(0) {}
+    };
+
+    struct Series {
+        std::vector<std::unique_ptr<Block>> blocks;  // oldest first, back() is open
+    };
+
+    static uint64_t bits_of(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static double double_of(uint64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static unsigned leading_zeros(uint64_t x) {
+        if (x == 0) {
+            return 64;
+        }
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_clzll(x));
+#else
+        unsigned n = 0;
+        for (; !(x & (1ULL << 63)); x <<= 1) {
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    static unsigned trailing_zeros(uint64_t x) {
+        if (x == 0) {
+            return 64;
+        }
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+        unsigned n = 0;
+        for (; !(x & 1); x >>= 1) {
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    static void write_xor(BitWriter& out, XorState& state, double value) {
+        uint64_t bits = bits_of(value);
+        uint64_t x = bits ^ state.previous;
+        state.previous = bits;
+        if (x == 0) {
+            out.write(0, 1);
+            return;
+        }
+        unsigned leading = std::min(31u, leading_zeros(x));
+        unsigned trailing = trailing_zeros(x);
+        if (state.leading != 64 && leading >= state.leading && trailing >= state.trailing) {
+            out.write(2, 2);  // '10': reuse the previous window
+            out.write(x >> state.trailing, 64 - state.leading - state.trailing);
+            return;
+        }
+        unsigned length = 64 - leading - trailing;
+        out.write(3, 2);  // '11': new window
+        out.write(leading, 5);
+        out.write(length - 1, 6);
+        out.write(x >> trailing, length);
+        state.leading = leading;
+        state.trailing = trailing;
+    }
+
+    static double read_xor(BitReader& in, XorState& state) {
+        if (in.bit()) {
+            if (in.bit()) {
+                state.leading = static_cast<unsigned>(in.read(5));
+                unsigned length = static_cast<unsigned>(in.read(6)) + 1;
+                state.trailing = 64 - state.leading - length;
+            }
+            unsigned length = 64 - state.leading - state.trailing;
+            state.previous ^= in.read(length) << state.trailing;
+        }
+        return double_of(state.previous);
+    }
+
+    static void write_timestamp(BitWriter& out, Cursor& c, int64_t timestamp) {
+        int64_t delta = timestamp - c.timestamp;
+        int64_t dod = delta - c.delta;
+        if (dod == 0) {
+            out.write(0, 1);
+        } else if (dod >= -63 && dod <= 64) {
+            out.write(2, 2);
+            out.write(static_cast<uint64_t>(dod + 63), 7);
+        } else if (dod >= -255 && dod <= 256) {
+            out.write(6, 3);
+            out.write(static_cast<uint64_t>(dod + 255), 9);
+        } else if (dod >= -2047 && dod <= 2048) {
+            out.write(14, 4);
+            out.write(static_cast<uint64_t>(dod + 2047), 12);
+        } else {
+            out.write(15, 4);
+            out.write(static_cast<uint64_t>(dod), 64);
+        }
+        c.timestamp = timestamp;
+        c.delta = delta;
+    }
+
+    static int64_t read_timestamp(BitReader& in, Cursor& c) {
+        int64_t dod = 0;
+        if (in.bit()) {
+            if (!in.bit()) {
+                dod = static_cast<int64_t>(in.read(7)) - 63;
+            } else if (!in.bit()) {
+                dod = static_cast<int64_t>(in.read(9)) - 255;
+            } else if (!in.bit()) {
+                dod = static_cast<int64_t>(in.read(12)) - 2047;
+            } else {
+                dod = static_cast<int64_t>(in.read(64));
+            }
+        }
+        c.delta += dod;
+        c.timestamp += c.delta;
+        return c.timestamp;
+    }
+
+    static void append(Block& block, const CoordinateData& data) {
+        Cursor& c = block.cursor;
+        if (block.count == 0) {
+            block.first_ms = data.timestamp;
+            c.timestamp = data.timestamp;  // first delta-of-delta is 0
+        }
+        write_timestamp(block.bits, c, data.timestamp);
+        write_xor(block.bits, c.lon, data.longitude);
+        write_xor(block.bits, c.lat, data.latitude);
+        if (block.count > 0 && data.sequence == c.sequence + 1) {
+            block.bits.write(0, 1);
+        } else {
+            block.bits.write(1, 1);
+            block.bits.write(data.sequence, 32);
+        }
+        c.sequence = data.sequence;
+        block.last_ms = data.timestamp;
+        ++block.count;
+    }
+
+    // Decodes the block's points in [from_ms, to_ms] into out, up to limit
+    static void decode(const Block& block, uint32_t entity_id, int64_t from_ms, int64_t to_ms,
+                       std::vector<CoordinateData>& out, size_t limit) {
+        BitReader in(block.bits.words());
+        Cursor c;
+        c.timestamp = block.first_ms;
+        for (size_t i = 0; i < block.count && out.size() < limit; ++i) {
+            int64_t timestamp = read_timestamp(in, c);
+            double lon = read_xor(in, c.lon);
+            double lat = read_xor(in, c.lat);
+            if (in.bit()) {
+                c.sequence = static_cast<uint32_t>(in.read(32));
+            } else {
+                c.sequence++;
+            }
+            if (timestamp > to_ms) {
+                break;
+            }
+            if (timestamp >= from_ms) {
+                out.push_back(CoordinateData(lon, lat, timestamp, c.sequence, entity_id));
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, Series> series_;
+    int64_t retention_ms_;
+    size_t bytes_;
+    uint64_t points_;
+    int64_t newest_ms_;      // newest timestamp of any entity
+    int64_t last_sweep_ms_;  // newest_ms_ at the last sweep
+    Metrics::Counter& points_total_;
+    Metrics::Gauge& bytes_gauge_;
+
+    size_t block_bytes(const Block& block) const {
+        return sizeof(Block) + block.bits.bytes();
+    }
+
+    // Drops the blocks that ended before cutoff; the open one only if `all`
+    void expire(Series& series, int64_t cutoff, bool all) {
+        size_t keep_last = all ? 0 : 1;
+        size_t expired = 0;
+        while (expired + keep_last < series.blocks.size() && series.blocks[expired]->last_ms < cutoff) {
+            bytes_ -= block_bytes(*series.blocks[expired]);
+            points_ -= series.blocks[expired]->count;
+            ++expired;
+        }
+        if (expired > 0) {
+            series.blocks.erase(series.blocks.begin(), series.blocks.begin() + expired);
+        }
+    }
+
+    // Retention against the newest time seen from any entity
+    void sweep_locked() {
+        last_sweep_ms_ = newest_ms_;
+        int64_t cutoff = newest_ms_ - retention_ms_;
+        for (auto it = series_.begin(); it != series_.end();) {
+            expire(it->second, cutoff, true);
+            if (it->second.blocks.empty()) {
+                it = series_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+public:
+    explicit HistoryStore(uint32_t retention_s = 6 * 3600)
+        : retention_ms_(static_cast<int64_t>(retention_s) * 1000)
+        , bytes_(0)
+        , points_(0)
+        , newest_ms_(0)
+        , last_sweep_ms_(0)
+        , points_total_(Metrics::counter("messenger_history_points_total",
+                                         "Samples appended to the compressed history"))
+        , bytes_gauge_(Metrics::gauge("messenger_history_bytes",
+                                      "Memory held by the compressed history blocks"))
+    {
+    }
+
+    void set_retention(uint32_t retention_s) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retention_ms_ = static_cast<int64_t>(retention_s) * 1000;
+    }
+
+    // Timestamps must strictly increase per entity (HISTORY pages resume at
+    // the last time + 1); other points are dropped
+    void add(const CoordinateData& data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Series& series = series_[data.entity_id];
+        if (!series.blocks.empty() && data.timestamp <= series.blocks.back()->last_ms) {
+            return;
+        }
+        if (series.blocks.empty() || series.blocks.back()->count == kBlockPoints) {
+            if (!series.blocks.empty()) {
+                Block& full = *series.blocks.back();
+                bytes_ -= block_bytes(full);
+                full.bits.shrink();
+                bytes_ += block_bytes(full);
+            }
+            series.blocks.emplace_back(new Block());
+            bytes_ += block_bytes(*series.blocks.back());
+        }
+        Block& block = *series.blocks.back();
+        size_t before = block_bytes(block);
+        append(block, data);
+        bytes_ += block_bytes(block) - before;
+        ++points_;
+        points_total_.inc();
+
+        expire(series, data.timestamp - retention_ms_, false);
+
+        // Entities that stopped reporting are only reached by the sweep
+        newest_ms_ = std::max(newest_ms_, data.timestamp);
+        if (newest_ms_ - last_sweep_ms_ >= kSweepIntervalMs) {
+            sweep_locked();
+        }
+        bytes_gauge_.set(static_cast<int64_t>(bytes_));
+    }
+
+    // Points of one entity with from_ms <= timestamp <= to_ms, oldest first,
+    // at most `limit`. False if the entity has no history.
+    bool range(uint32_t entity_id, int64_t from_ms, int64_t to_ms, std::vector<CoordinateData>& out,
+               size_t limit = static_cast<size_t>(-1)) const {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = series_.find(entity_id);
+        if (it == series_.end()) {
+            return false;
+        }
+        const std::vector<std::unique_ptr<Block>>& blocks = it->second.blocks;
+        // Block time ranges are ordered: the first one ending at or after from_ms
+        auto first = std::lower_bound(blocks.begin(), blocks.end(), from_ms,
+            [](const std::unique_ptr<Block>& block, int64_t t) { return block->last_ms < t; });
+        for (auto b = first; b != blocks.end() && (*b)->first_ms <= to_ms && out.size() < limit; ++b) {
+            decode(**b, entity_id, from_ms, to_ms, out, limit);
+        }
+        return true;
+    }
+
+    int64_t retention_ms() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return retention_ms_;
+    }
+
+    size_t entities() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return series_.size();
+    }
+
+    uint64_t points() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return points_;
+    }
+
+    size_t bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+};
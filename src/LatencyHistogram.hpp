@@ -0,0 +1,145 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Log-linear histogram of non-negative integer samples (typically µs or ns).
+// Values below 2^(SubBits+1) are exact; above that every power of two is
+// split into 2^SubBits buckets: SubBits = 6 gives ~1.6% relative error in
+// ~30 KB, SubBits = 2 ~25% in ~2 KB. Buckets are allocated on the first
+// sample. Not thread-safe: keep one per thread and merge() them for reporting.
+template <int SubBits>
+class BasicLatencyHistogram {
+private:
+    static const int kSubBits = SubBits;
+    static const uint64_t kSubCount = 1u << kSubBits;
+    static const size_t kBucketCount = (64 - kSubBits + 1) * kSubCount;
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+
+    static int msb(uint64_t v) {
+        int n = 0;
+        while (v >>= 1) {
+            ++n;
+        }
+        return n;
+    }
+
+    static size_t index_of(uint64_t v) {
+        if (v < 2 * kSubCount) {
+            return static_cast<size_t>(v);
+        }
+        int shift = msb(v) - kSubBits;
+        return static_cast<size_t>((shift + 1) * kSubCount + ((v >> shift) - kSubCount));
+    }
+
+    // Largest value that falls into the bucket
+    static uint64_t upper_bound_of(size_t index) {
+        if (index < 2 * kSubCount) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubCount) - 1;
+        uint64_t top = index % kSubCount + kSubCount;
+        return ((top + 1) << shift) - 1;
+    }
+
+public:
+    BasicLatencyHistogram()
+        : count_(0)
+        , min_(std::numeric_limits<uint64_t>::max())
+        , max_(0)
+        , sum_(0.0)
+    {
+    }
+
+    void record(int64_t value) {
+        uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+        if (buckets_.empty()) {
+            buckets_.resize(kBucketCount, 0);
+        }
+        buckets_[index_of(v)]++;
+        count_++;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+        sum_ += static_cast<double>(v);
+    }
+
+    void merge(const BasicLatencyHistogram& other) {
+        if (other.buckets_.empty()) {
+            return;
+        }
+        if (buckets_.empty()) {
+            buckets_.resize(kBucketCount, 0);
+        }
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    void reset() {
+        *this = BasicLatencyHistogram();
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? sum_ / static_cast<double>(count_) : 0.0; }
+
+    // p in [0, 100]
+    uint64_t percentile(double p) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count_) + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, count_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return std::min(upper_bound_of(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    // One-line summary, e.g. "n=1000 min=12 p50=40 p90=55 p99=80 p99.9=120 max=300 mean=42.1 us"
+    std::string summary(const char* unit) const {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "n=%llu min=%llu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu mean=%.1f %s",
+                 static_cast<unsigned long long>(count_),
+                 static_cast<unsigned long long>(min()),
+                 static_cast<unsigned long long>(percentile(50)),
+                 static_cast<unsigned long long>(percentile(90)),
+                 static_cast<unsigned long long>(percentile(99)),
+                 static_cast<unsigned long long>(percentile(99.9)),
+                 static_cast<unsigned long long>(max_),
+                 mean(), unit);
+        return buffer;
+    }
+
+    // Non-empty buckets as "upper_bound,count" lines
+    void write_csv(FILE* out) const {
+        fprintf(out, "upper_bound,count\n");
+        for (size_t i = 0; i < buckets_.size(); ++i) {
+            if (buckets_[i] != 0) {
+                fprintf(out, "%llu,%llu\n",
+                        static_cast<unsigned long long>(upper_bound_of(i)),
+                        static_cast<unsigned long long>(buckets_[i]));
+            }
+        }
+    }
+};
+
+typedef BasicLatencyHistogram<6> LatencyHistogram;
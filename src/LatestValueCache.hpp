@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "SharedCoordinateState.hpp"
+
+// Pre-rendered HTTP bodies for the latest-value endpoints. Each entity's
+// JSON is rendered once when its state changes; the /latest document is
+// joined from those pieces at most once per update. Requests only copy a
+// shared, immutable body.
+class LatestValueCache {
+public:
+    struct Rendered {
+        std::string body;
+        std::string etag;
+    };
+    typedef std::shared_ptr<const Rendered> rendered_ptr;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<uint32_t, rendered_ptr> entities_;  // ordered by id for a stable /latest
+    uint64_t version_;
+    rendered_ptr latest_;  // null until requested after an update
+
+    static std::string etag_of(uint64_t version) {
+        return "\"" + std::to_string(version) + "\"";
+    }
+
+public:
+    LatestValueCache() : version_(0) {}
+
+    void update(const CoordinateData& data) {
+        auto rendered = std::make_shared<Rendered>();
+        rendered->body = data.to_json();
+        std::lock_guard<std::mutex> lock(mutex_);
+        rendered->etag = etag_of(++version_);
+        entities_[data.entity_id] = rendered;
+        latest_.reset();
+    }
+
+    // Null if the entity has never been seen
+    rendered_ptr entity(uint32_t entity_id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entities_.find(entity_id);
+        return it == entities_.end() ? rendered_ptr() : it->second;
+    }
+
+    // {"entities":[...]} with the newest state of every entity
+    rendered_ptr latest() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!latest_) {
+            auto rendered = std::make_shared<Rendered>();
+            size_t size = 16;
+            for (const auto& entry : entities_) {
+                size += entry.second->body.size() + 1;
+            }
+            rendered->body.reserve(size);
+            rendered->body.append("{\"entities\":[");
+            bool first = true;
+            for (const auto& entry : entities_) {
+                if (!first) {
+                    rendered->body += ',';
+                }
+                rendered->body += entry.second->body;
+                first = false;
+            }
+            rendered->body += "]}";
+            rendered->etag = etag_of(version_);
+            latest_ = rendered;
+        }
+        return latest_;
+    }
+};
@@ -1,7 +1,7 @@
 #include "MessengerPublisherApp.hpp"
 
-#include <condition_variable>
 #include <csignal>
+#include <cstdio>
 #include <stdexcept>
 #include <thread>
 #include <sstream>
@@ -14,14 +14,21 @@
 #include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
 #include <fastdds/dds/publisher/qos/PublisherQos.hpp>
 
+#include "AsyncLogger.hpp"
 #include "MessengerPubSubTypes.hpp"
+#include "Tracer.hpp"
 
 using namespace eprosima::fastdds::dds;
 
 MessengerPublisherApp::MessengerPublisherApp(
         const int& domain_id)
-    : factory_(nullptr)
-    , participant_(nullptr)
+    : MessengerPublisherApp(std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_pub_participant"))
+{
+}
+
+MessengerPublisherApp::MessengerPublisherApp(
+        std::shared_ptr<SharedParticipant> participant)
+    : participant_(participant)
     , publisher_(nullptr)
     , topic_(nullptr)
     , writer_(nullptr)
@@ -30,37 +37,29 @@ MessengerPublisherApp::MessengerPublisherApp(
     , samples_sent_(0)
     , last_published_sequence_(0)
     , stop_(false)
+    , own_io_(nullptr)
+    , wheel_(nullptr)
+    , publish_task_(0)
+    , published_total_(Metrics::counter("messenger_dds_samples_published_total",
+                                        "Samples written to the DDS topic"))
+    , write_failures_total_(Metrics::counter("messenger_dds_write_failures_total",
+                                             "DataWriter::write calls that did not return OK"))
+    , suppressed_total_(Metrics::counter("messenger_dds_samples_suppressed_total",
+                                         "Samples not sent because subscribers can dead-reckon them"))
+    , matched_readers_(Metrics::gauge("messenger_dds_matched_readers",
+                                      "DataReaders matched with the publisher's DataWriter"))
 {
-    // Create the participant
-    DomainParticipantQos pqos = PARTICIPANT_QOS_DEFAULT;
-    pqos.name("Messenger::Message_pub_participant");
-    factory_ = DomainParticipantFactory::get_shared_instance();
-    participant_ = factory_->create_participant(domain_id, pqos, nullptr, StatusMask::none());
-    if (participant_ == nullptr)
-    {
-        throw std::runtime_error("Messenger::Message Participant initialization failed");
-    }
-
-    // Register the type
-    type_.register_type(participant_);
-
     // Create the publisher
     PublisherQos pub_qos = PUBLISHER_QOS_DEFAULT;
-    participant_->get_default_publisher_qos(pub_qos);
-    publisher_ = participant_->create_publisher(pub_qos, nullptr, StatusMask::none());
+    participant_->get()->get_default_publisher_qos(pub_qos);
+    publisher_ = participant_->get()->create_publisher(pub_qos, nullptr, StatusMask::none());
     if (publisher_ == nullptr)
     {
         throw std::runtime_error("Messenger::Message Publisher initialization failed");
     }
 
-    // Create the topic
-    TopicQos topic_qos = TOPIC_QOS_DEFAULT;
-    participant_->get_default_topic_qos(topic_qos);
-    topic_ = participant_->create_topic("Movie Discussion List", type_.get_type_name(), topic_qos);
-    if (topic_ == nullptr)
-    {
-        throw std::runtime_error("Messenger::Message Topic initialization failed");
-    }
+    // Register the type and get the topic (shared with a subscriber app on the same participant)
+    topic_ = participant_->topic("Movie Discussion List", type_);
 
     // Create the data writer
     DataWriterQos writer_qos = DATAWRITER_QOS_DEFAULT;
@@ -77,13 +76,14 @@ MessengerPublisherApp::MessengerPublisherApp(
 
 MessengerPublisherApp::~MessengerPublisherApp()
 {
-    if (nullptr != participant_)
+    // Only this app's entities; the topic and participant go with the last SharedParticipant reference
+    if (nullptr != writer_)
     {
-        // Delete DDS entities contained within the DomainParticipant
-        participant_->delete_contained_entities();
-
-        // Delete DomainParticipant
-        factory_->delete_participant(participant_);
+        publisher_->delete_datawriter(writer_);
+    }
+    if (nullptr != publisher_)
+    {
+        participant_->get()->delete_publisher(publisher_);
     }
 }
 
@@ -97,8 +97,8 @@ void MessengerPublisherApp::on_publication_matched(
             std::lock_guard<std::mutex> lock(mutex_);
             matched_ = info.current_count;
         }
-        std::cout << "[DDS Publisher] Matched with subscriber." << std::endl;
-        cv_.notify_one();
+        matched_readers_.set(info.current_count);
+        APP_LOG_INFO("DDS Publisher") << "Matched with subscriber.";
     }
     else if (info.current_count_change == -1)
     {
@@ -106,61 +106,69 @@ void MessengerPublisherApp::on_publication_matched(
             std::lock_guard<std::mutex> lock(mutex_);
             matched_ = info.current_count;
         }
-        std::cout << "[DDS Publisher] Unmatched from subscriber." << std::endl;
+        matched_readers_.set(info.current_count);
+        APP_LOG_INFO("DDS Publisher") << "Unmatched from subscriber.";
     }
     else
     {
-        std::cout << info.current_count_change
-                  << " is not a valid value for PublicationMatchedStatus current count change" << std::endl;
+        APP_LOG_WARN("DDS Publisher") << info.current_count_change
+                  << " is not a valid value for PublicationMatchedStatus current count change";
     }
 }
 
 void MessengerPublisherApp::run()
+{
+    // Own io_context and wheel; the publish task is the only one on it
+    asio::io_context io;
+    TimingWheel wheel(io);
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        own_io_ = &io;
+    }
+    start(wheel);
+    if (!is_stopped())
+    {
+        io.run();
+    }
+    // A concurrent stop() holds wheel_mutex_ while it uses the wheel; once
+    // the pointers are cleared here it no longer reaches these locals
+    std::lock_guard<std::mutex> lock(wheel_mutex_);
+    own_io_ = nullptr;
+    wheel_ = nullptr;
+}
+
+void MessengerPublisherApp::start(
+        TimingWheel& wheel)
 {
     if (!shared_state_) {
-        std::cerr << "[DDS Publisher] ERROR: Shared state not set!" << std::endl;
+        APP_LOG_ERROR("DDS Publisher") << "Shared state not set!";
         return;
     }
-    
-    std::cout << "[DDS Publisher] Starting at ~" 
-              << (1000.0 / dds_publish_rate_ms_) << "Hz" << std::endl;
-    std::cout << "[DDS Publisher] Reading from shared coordinate state" << std::endl;
-    
-    // Deadline-based timing để tránh drift
-    auto period = std::chrono::milliseconds(dds_publish_rate_ms_);
-    auto next_deadline = std::chrono::steady_clock::now() + period;
-    
-    while (!is_stopped())
+
+    APP_LOG_INFO("DDS Publisher") << "Starting at ~"
+              << (1000.0 / dds_publish_rate_ms_) << "Hz";
+    APP_LOG_INFO("DDS Publisher") << "Reading from shared coordinate state";
+
+    publish_task_ = wheel.schedule_periodic("dds-publish", std::chrono::milliseconds(dds_publish_rate_ms_),
+                    [this]()
+                    {
+                        publish_tick();
+                    });
+    std::lock_guard<std::mutex> lock(wheel_mutex_);
+    wheel_ = &wheel;
+}
+
+void MessengerPublisherApp::publish_tick()
+{
+    if (publish_from_shared_state())
     {
-        if (publish_from_shared_state())
-        {
-            samples_sent_++;
-            if (samples_sent_ % 50 == 0) {  // Log mỗi 50 samples
-                auto latest = shared_state_->get_latest();
-                std::cout << "[DDS Publisher] Sent " << samples_sent_ 
-                         << " samples. Latest seq: " << latest->sequence << std::endl;
-            }
-        }
-        
-        // Sleep đến deadline tiếp theo (bù trừ thời gian xử lý)
-        std::unique_lock<std::mutex> period_lock(mutex_);
-        cv_.wait_until(period_lock, next_deadline, [this]()
-                {
-                    return is_stopped();
-                });
-        
-        // Cập nhật deadline cho lần tiếp theo
-        next_deadline += period;
-        
-        // Nếu bị trễ quá nhiều, reset deadline
-        auto now = std::chrono::steady_clock::now();
-        if (next_deadline < now - period * 2) {
-            std::cerr << "[DDS Publisher] WARNING: Deadline drift detected, resetting" << std::endl;
-            next_deadline = now + period;
+        uint32_t sent = ++samples_sent_;
+        if (sent % 50 == 0) {  // Log mỗi 50 samples
+            auto latest = shared_state_->get_latest();
+            APP_LOG_INFO("DDS Publisher") << "Sent " << sent
+                     << " samples. Latest seq: " << latest->sequence;
         }
     }
-    
-    std::cout << "[DDS Publisher] Total samples published: " << samples_sent_ << std::endl;
 }
 
 void MessengerPublisherApp::set_shared_state(std::shared_ptr<SharedCoordinateState> state)
@@ -168,6 +176,13 @@ void MessengerPublisherApp::set_shared_state(std::shared_ptr<SharedCoordinateSta
     shared_state_ = state;
 }
 
+void MessengerPublisherApp::set_dead_reckoning(
+        double tolerance_m,
+        uint32_t heartbeat_ms)
+{
+    dead_reckoning_.reset(new DeadReckoning(tolerance_m, heartbeat_ms));
+}
+
 bool MessengerPublisherApp::publish_from_shared_state()
 {
     if (!shared_state_ || !shared_state_->has_data()) {
@@ -176,12 +191,13 @@ bool MessengerPublisherApp::publish_from_shared_state()
     
     bool ret = false;
     
-    // Wait for the data endpoints discovery
+    // Nothing to do until the data endpoints are discovered; the task runs
+    // on a shared thread and must not block waiting for a match
     std::unique_lock<std::mutex> matched_lock(mutex_);
-    cv_.wait(matched_lock, [&]()
-            {
-                return ((matched_ > 0) || is_stopped());
-            });
+    if (matched_ == 0)
+    {
+        return false;
+    }
 
     if (!is_stopped())
     {
@@ -193,18 +209,42 @@ bool MessengerPublisherApp::publish_from_shared_state()
             return false;
         }
         
+        // Dead reckoning: skip what the subscribers can predict, and send
+        // the velocity they predict from ("lon,lat,timestamp,vlon,vlat")
+        std::string text = coord_data->to_csv();
+        if (dead_reckoning_)
+        {
+            GeoVelocity velocity;
+            if (!dead_reckoning_->observe(*coord_data, velocity))
+            {
+                last_published_sequence_ = coord_data->sequence;
+                suppressed_total_.inc();
+                return false;
+            }
+            char motion[64];
+            snprintf(motion, sizeof(motion), ",%.9g,%.9g", velocity.lon_per_s, velocity.lat_per_s);
+            text += motion;
+        }
+
         // Tạo DDS message
         Messenger::Message sample_;
         sample_.from("CoordinatePublisher");
         sample_.subject("GPS_Coordinates");
         sample_.subject_id(1);
-        sample_.text(coord_data->to_csv());
+        sample_.text(text);
         sample_.count(coord_data->sequence);
         
-        ret = (RETCODE_OK == writer_->write(&sample_));
+        {
+            // Serialization happens inside write()
+            TRACE_SPAN_SEQ("dds_write", coord_data->sequence);
+            ret = (RETCODE_OK == writer_->write(&sample_));
+        }
         
         if (ret) {
             last_published_sequence_ = coord_data->sequence;
+            published_total_.inc();
+        } else {
+            write_failures_total_.inc();
         }
     }
     
@@ -219,5 +259,29 @@ bool MessengerPublisherApp::is_stopped()
 void MessengerPublisherApp::stop()
 {
     stop_.store(true);
-    cv_.notify_one();
+    {
+        // run() cannot tear its wheel and io_context down while this is held
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        if (wheel_ != nullptr)
+        {
+            TimingWheel::TaskStats stats;
+            if (wheel_->stats_of(publish_task_, stats))
+            {
+                APP_LOG_INFO("DDS Publisher") << "Publish jitter: " << TimingWheel::format(stats);
+            }
+            wheel_->cancel(publish_task_);
+        }
+        if (own_io_ != nullptr)
+        {
+            own_io_->stop();
+        }
+    }
+    APP_LOG_INFO("DDS Publisher") << "Total samples published: " << samples_sent_.load();
+    // A tick may still be running; the dead-reckoning state is guarded by mutex_
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dead_reckoning_)
+    {
+        APP_LOG_INFO("DDS Publisher") << "Dead reckoning suppressed " << dead_reckoning_->suppressed()
+                  << " of " << (dead_reckoning_->sent() + dead_reckoning_->suppressed()) << " samples";
+    }
 }
\ No newline at end of file
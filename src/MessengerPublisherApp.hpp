@@ -22,15 +22,21 @@
 #ifndef FAST_DDS_GENERATED__MESSENGER_MESSENGERPUBLISHERAPP_HPP
 #define FAST_DDS_GENERATED__MESSENGER_MESSENGERPUBLISHERAPP_HPP
 
-#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #include <fastdds/dds/domain/DomainParticipant.hpp>
 #include <fastdds/dds/domain/DomainParticipantFactory.hpp>
 #include <fastdds/dds/publisher/DataWriterListener.hpp>
 #include <fastdds/dds/topic/TypeSupport.hpp>
 
+#include "DeadReckoning.hpp"
 #include "MessengerApplication.hpp"
+#include "Metrics.hpp"
 #include "SharedCoordinateState.hpp"
+#include "SharedParticipant.hpp"
+#include "TimingWheel.hpp"
 
 class MessengerPublisherApp : public MessengerApplication,
         public eprosima::fastdds::dds::DataWriterListener
@@ -40,6 +46,10 @@ public:
     MessengerPublisherApp(
             const int& domain_id);
 
+    //! Create the endpoints on a participant shared with other apps of this process
+    MessengerPublisherApp(
+            std::shared_ptr<SharedParticipant> participant);
+
     ~MessengerPublisherApp();
 
     //! Publisher matched method
@@ -53,30 +63,50 @@ public:
     //! Trigger the end of execution
     void stop() override;
 
+    //! Publish from a task on a shared timing wheel instead of run(); never blocks
+    void start(
+            TimingWheel& wheel);
+
     void set_shared_state(std::shared_ptr<SharedCoordinateState> state);
 
+    //! Only send a position when it is more than tolerance_m away from where
+    //! subscribers extrapolate it, or heartbeat_ms after the last one sent
+    void set_dead_reckoning(
+            double tolerance_m,
+            uint32_t heartbeat_ms);
+
 private:
 
     //! Return the current state of execution
     bool is_stopped();
 
-    //! Publish a sample from shared state
+    //! Publish a sample from shared state; skipped while no reader is matched
     bool publish_from_shared_state();
+
+    //! One periodic publish task run
+    void publish_tick();
     
     std::shared_ptr<SharedCoordinateState> shared_state_;
-    std::shared_ptr<eprosima::fastdds::dds::DomainParticipantFactory> factory_;
-    eprosima::fastdds::dds::DomainParticipant* participant_;
+    std::shared_ptr<SharedParticipant> participant_;
     eprosima::fastdds::dds::Publisher* publisher_;
     eprosima::fastdds::dds::Topic* topic_;
     eprosima::fastdds::dds::DataWriter* writer_;
     eprosima::fastdds::dds::TypeSupport type_;
-    std::condition_variable cv_;
     int32_t matched_;
     std::mutex mutex_;
     const uint32_t dds_publish_rate_ms_ = 50; // DDS publishes at ~20Hz
-    uint32_t samples_sent_;
+    std::atomic<uint32_t> samples_sent_;
     uint32_t last_published_sequence_;
+    std::unique_ptr<DeadReckoning> dead_reckoning_;  // null = send every new sample
     std::atomic<bool> stop_;
+    std::mutex wheel_mutex_;  // guards own_io_ and wheel_ against run() tearing them down
+    asio::io_context* own_io_;  // set while run() drives its own wheel
+    TimingWheel* wheel_;
+    TimingWheel::TaskId publish_task_;
+    Metrics::Counter& published_total_;
+    Metrics::Counter& write_failures_total_;
+    Metrics::Counter& suppressed_total_;
+    Metrics::Gauge& matched_readers_;
 };
 
 #endif // FAST_DDS_GENERATED__MESSENGER_MESSENGERPUBLISHERAPP_HPP
\ No newline at end of file
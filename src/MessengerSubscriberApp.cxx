@@ -1,7 +1,13 @@
 #include "MessengerSubscriberApp.hpp"
 #include "WebSocketServer.hpp"
+#include "SharedCoordinateState.hpp"
+#include "CoordinateGenerator.hpp"
 
+#include <cerrno>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstdlib>
 #include <stdexcept>
 #include <sstream>
 
@@ -13,51 +19,77 @@
 #include <fastdds/dds/subscriber/SampleInfo.hpp>
 #include <fastdds/dds/subscriber/Subscriber.hpp>
 
+#include "AsyncLogger.hpp"
 #include "MessengerPubSubTypes.hpp"
+#include "Tracer.hpp"
 
 using namespace eprosima::fastdds::dds;
 
+namespace {
+
+// Checked number parsing for the text field: these run in the DDS listener,
+// where std::stod/std::stoll would throw on a malformed sample
+bool parse_double(
+        const std::string& str,
+        double& out)
+{
+    char* end = nullptr;
+    out = std::strtod(str.c_str(), &end);
+    return end != str.c_str() && *end == '\0' && std::isfinite(out);
+}
+
+bool parse_int64(
+        const std::string& str,
+        int64_t& out)
+{
+    char* end = nullptr;
+    errno = 0;
+    long long value = std::strtoll(str.c_str(), &end, 10);
+    out = value;
+    return end != str.c_str() && *end == '\0' && errno != ERANGE;
+}
+
+} // namespace
 
 MessengerSubscriberApp::MessengerSubscriberApp(const int& domain_id)
-    : factory_(nullptr)
-    , participant_(nullptr)
+    : MessengerSubscriberApp(std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_sub_participant"))
+{
+}
+
+MessengerSubscriberApp::MessengerSubscriberApp(std::shared_ptr<SharedParticipant> participant)
+    : spatial_index_(std::make_shared<SpatialIndex>())
+    , trail_store_(std::make_shared<TrailStore>())
+    , history_store_(std::make_shared<HistoryStore>())
+    , participant_(participant)
     , subscriber_(nullptr)
     , topic_(nullptr)
     , reader_(nullptr)
     , type_(new Messenger::MessagePubSubType())
     , samples_received_(0)
     , stop_(false)
+    , created_(std::chrono::steady_clock::now())
+    , got_first_sample_(false)
+    , received_total_(Metrics::counter("messenger_dds_samples_received_total",
+                                       "Samples taken from the DDS topic"))
+    , parse_failures_total_(Metrics::counter("messenger_dds_parse_failures_total",
+                                             "Received samples whose text was not lon,lat,timestamp"))
+    , matched_writers_(Metrics::gauge("messenger_dds_matched_writers",
+                                      "DataWriters matched with the subscriber's DataReader"))
+    , sample_age_(Metrics::histogram("messenger_dds_sample_age_seconds",
+                                     "Time from coordinate generation to reception (wall clock, ms resolution)",
+                                     Metrics::Histogram::exponential(1e-3, 10.0)))
 {
-    // Create the participant
-    DomainParticipantQos pqos = PARTICIPANT_QOS_DEFAULT;
-    pqos.name("Messenger::Message_sub_participant");
-    factory_ = DomainParticipantFactory::get_shared_instance();
-    participant_ = factory_->create_participant(domain_id, pqos, nullptr, StatusMask::none());
-    if (participant_ == nullptr)
-    {
-        throw std::runtime_error("Messenger::Message Participant initialization failed");
-    }
-
-    // Register the type
-    type_.register_type(participant_);
-
     // Create the subscriber
     SubscriberQos sub_qos = SUBSCRIBER_QOS_DEFAULT;
-    participant_->get_default_subscriber_qos(sub_qos);
-    subscriber_ = participant_->create_subscriber(sub_qos, nullptr, StatusMask::none());
+    participant_->get()->get_default_subscriber_qos(sub_qos);
+    subscriber_ = participant_->get()->create_subscriber(sub_qos, nullptr, StatusMask::none());
     if (subscriber_ == nullptr)
     {
         throw std::runtime_error("Messenger::Message Subscriber initialization failed");
     }
 
-    // Create the topic
-    TopicQos topic_qos = TOPIC_QOS_DEFAULT;
-    participant_->get_default_topic_qos(topic_qos);
-    topic_ = participant_->create_topic("Movie Discussion List", type_.get_type_name(), topic_qos);
-    if (topic_ == nullptr)
-    {
-        throw std::runtime_error("Messenger::Message Topic initialization failed");
-    }
+    // Register the type and get the topic (shared with a publisher app on the same participant)
+    topic_ = participant_->topic("Movie Discussion List", type_);
 
     // Create the reader
     DataReaderQos reader_qos = DATAREADER_QOS_DEFAULT;
@@ -80,13 +112,14 @@ MessengerSubscriberApp::MessengerSubscriberApp(const int& domain_id)
 
 MessengerSubscriberApp::~MessengerSubscriberApp()
 {
-    if (nullptr != participant_)
+    // Only this app's entities; the topic and participant go with the last SharedParticipant reference
+    if (nullptr != reader_)
     {
-        // Delete DDS entities contained within the DomainParticipant
-        participant_->delete_contained_entities();
-
-        // Delete DomainParticipant
-        factory_->delete_participant(participant_);
+        subscriber_->delete_datareader(reader_);
+    }
+    if (nullptr != subscriber_)
+    {
+        participant_->get()->delete_subscriber(subscriber_);
     }
 }
 
@@ -94,18 +127,21 @@ void MessengerSubscriberApp::on_subscription_matched(
         DataReader* /*reader*/,
         const SubscriptionMatchedStatus& info)
 {
+    matched_writers_.set(info.current_count);
     if (info.current_count_change == 1)
     {
-        std::cout << "Messenger::Message Subscriber matched." << std::endl;
+        APP_LOG_INFO("Subscriber") << "Messenger::Message Subscriber matched "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - created_).count() << "ms after start.";
     }
     else if (info.current_count_change == -1)
     {
-        std::cout << "Messenger::Message Subscriber unmatched." << std::endl;
+        APP_LOG_INFO("Subscriber") << "Messenger::Message Subscriber unmatched.";
     }
     else
     {
-        std::cout << info.current_count_change
-                  << " is not a valid value for SubscriptionMatchedStatus current count change" << std::endl;
+        APP_LOG_WARN("Subscriber") << info.current_count_change
+                  << " is not a valid value for SubscriptionMatchedStatus current count change";
     }
 }
 
@@ -123,55 +159,114 @@ void MessengerSubscriberApp::on_data_available(DataReader* reader)
     {
         if ((info.instance_state == ALIVE_INSTANCE_STATE) && info.valid_data)
         {
+            TRACE_SPAN_SEQ("dds_receive", static_cast<uint32_t>(sample_.count()));
             samples_received_++;
+            received_total_.inc();
+            if (!got_first_sample_)
+            {
+                // Time-to-first-sample after a restart (see bench-startup)
+                got_first_sample_ = true;
+                APP_LOG_INFO("Subscriber") << "First sample "
+                         << std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - created_).count() << "ms after start";
+            }
             
-            // Parse tọa độ từ text field (format: "lon,lat,timestamp")
+            // Parse tọa độ từ text field (format: "lon,lat,timestamp"
+            // or, from a dead-reckoning publisher, "lon,lat,timestamp,vlon,vlat")
             std::string text = sample_.text();
             std::istringstream iss(text);
-            std::string lon_str, lat_str, time_str;
+            std::string lon_str, lat_str, time_str, vlon_str, vlat_str;
+            double lon = 0.0;
+            double lat = 0.0;
+            int64_t timestamp = 0;
             
+            // A field that does not parse drops the whole sample
             if (std::getline(iss, lon_str, ',') && 
                 std::getline(iss, lat_str, ',') && 
-                std::getline(iss, time_str))
+                std::getline(iss, time_str, ',') &&
+                parse_double(lon_str, lon) &&
+                parse_double(lat_str, lat) &&
+                parse_int64(time_str, timestamp))
             {
-                double lon = std::stod(lon_str);
-                double lat = std::stod(lat_str);
-                int64_t timestamp = std::stoll(time_str);
+                GeoVelocity velocity;
+                if (std::getline(iss, vlon_str, ',') && std::getline(iss, vlat_str))
+                {
+                    // Bad velocity: keep the sample, just don't extrapolate it
+                    double vlon = 0.0;
+                    double vlat = 0.0;
+                    if (parse_double(vlon_str, vlon) && parse_double(vlat_str, vlat))
+                    {
+                        velocity.lon_per_s = vlon;
+                        velocity.lat_per_s = vlat;
+                    }
+                    else
+                    {
+                        parse_failures_total_.inc();
+                    }
+                }
+                sample_age_.observe((CoordinateGenerator::get_timestamp() - timestamp) / 1000.0);
                 
                 // Log mỗi 100 samples
                 if (samples_received_ % 100 == 0) {
-                    std::cout << "[Subscriber] Sample #" << samples_received_ 
+                    APP_LOG_INFO("Subscriber") << "Sample #" << samples_received_ 
                              << " - Coords: [" << lon << ", " << lat 
-                             << "] at " << timestamp << "ms" << std::endl;
+                             << "] at " << timestamp << "ms";
                 }
                 
+                CoordinateData data(lon, lat, timestamp, sample_.count(), sample_.subject_id());
+                // Track first: a prediction in flight from the old track is
+                // applied before this sample below, not after it
+                dead_reckoning_.on_sample(data, velocity);
+                spatial_index_->update(data);
+                trail_store_->add(data);
+                history_store_->add(data);
+
                 // Forward qua WebSocket nếu có
                 if (ws_server_)
                 {
-                    std::ostringstream json;
-                    json << "{\"coords\":[" << std::fixed << std::setprecision(8) 
-                         << lon << "," << lat << "],"
-                         << "\"time\":" << timestamp 
-                         << ",\"sample_id\":" << samples_received_ << "}";
-                    
-                    ws_server_->broadcast(json.str());
+                    ws_server_->broadcast_coordinates(data);
                 }
             }
             else
             {
-                std::cout << "[Subscriber] Sample #" << samples_received_ 
-                         << " RECEIVED (unparsed)" << std::endl;
+                parse_failures_total_.inc();
+                APP_LOG_INFO("Subscriber") << "Sample #" << samples_received_ 
+                         << " RECEIVED (unparsed)";
             }
         }
     }
 }
 
+void MessengerSubscriberApp::set_dead_reckoning_horizon(
+        uint32_t horizon_ms)
+{
+    dead_reckoning_.set_horizon(horizon_ms);
+}
+
 void MessengerSubscriberApp::run()
 {
+    // Fill in dead-reckoned positions at the publisher's rate until stopped
     std::unique_lock<std::mutex> lck(terminate_cv_mtx_);
-    terminate_cv_.wait(lck, [this]
+    while (!terminate_cv_.wait_for(lck, std::chrono::milliseconds(50), [this]
             {
                 return is_stopped();
+            }))
+    {
+        lck.unlock();
+        reconstruct();
+        lck.lock();
+    }
+}
+
+void MessengerSubscriberApp::reconstruct()
+{
+    dead_reckoning_.extrapolate(CoordinateGenerator::get_timestamp(), [this](const CoordinateData& data)
+            {
+                spatial_index_->update(data);
+                if (ws_server_)
+                {
+                    ws_server_->broadcast_coordinates(data);
+                }
             });
 }
 
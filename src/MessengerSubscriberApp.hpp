@@ -22,6 +22,7 @@
 #ifndef FAST_DDS_GENERATED__MESSENGER_MESSENGERSUBSCRIBERAPP_HPP
 #define FAST_DDS_GENERATED__MESSENGER_MESSENGERSUBSCRIBERAPP_HPP
 
+#include <chrono>
 #include <condition_variable>
 
 #include <fastdds/dds/domain/DomainParticipant.hpp>
@@ -29,8 +30,14 @@
 #include <fastdds/dds/subscriber/DataReaderListener.hpp>
 #include <fastdds/dds/topic/TypeSupport.hpp>
 
+#include "DeadReckoning.hpp"
+#include "HistoryStore.hpp"
 #include "Messenger.hpp"
 #include "MessengerApplication.hpp"
+#include "Metrics.hpp"
+#include "SharedParticipant.hpp"
+#include "SpatialIndex.hpp"
+#include "TrailStore.hpp"
 
 class MessengerSubscriberApp : public MessengerApplication,
         public eprosima::fastdds::dds::DataReaderListener
@@ -40,6 +47,10 @@ public:
     MessengerSubscriberApp(
             const int& domain_id);
 
+    //! Create the endpoints on a participant shared with other apps of this process
+    MessengerSubscriberApp(
+            std::shared_ptr<SharedParticipant> participant);
+
     virtual ~MessengerSubscriberApp();
 
     //! Subscription callback
@@ -59,21 +70,57 @@ public:
     
     void set_websocket_server(std::shared_ptr<class WebSocketServer> ws_server);
 
+    //! Extrapolate dead-reckoned entities (samples carrying a velocity) for
+    //! up to horizon_ms after their last sample; 0 disables
+    void set_dead_reckoning_horizon(
+            uint32_t horizon_ms);
+
+    //! Latest position of every entity received, for spatial queries
+    std::shared_ptr<SpatialIndex> spatial_index() const
+    {
+        return spatial_index_;
+    }
+
+    //! Simplified recent track of every entity received (samples only, not
+    //! dead-reckoned positions)
+    std::shared_ptr<TrailStore> trail_store() const
+    {
+        return trail_store_;
+    }
+
+    //! Compressed history of every entity received (samples only)
+    std::shared_ptr<HistoryStore> history_store() const
+    {
+        return history_store_;
+    }
+
 
 private:
 
     //! Return the current state of execution
     bool is_stopped();
 
+    //! Positions between dead-reckoned samples, to the index and WebSocket
+    void reconstruct();
+
     std::shared_ptr<class WebSocketServer> ws_server_;
-    std::shared_ptr<eprosima::fastdds::dds::DomainParticipantFactory> factory_;
-    eprosima::fastdds::dds::DomainParticipant* participant_;
+    std::shared_ptr<SpatialIndex> spatial_index_;
+    std::shared_ptr<TrailStore> trail_store_;
+    std::shared_ptr<HistoryStore> history_store_;
+    DeadReckoningTracks dead_reckoning_;
+    std::shared_ptr<SharedParticipant> participant_;
     eprosima::fastdds::dds::Subscriber* subscriber_;
     eprosima::fastdds::dds::Topic* topic_;
     eprosima::fastdds::dds::DataReader* reader_;
     eprosima::fastdds::dds::TypeSupport type_;
     uint16_t samples_received_;
     std::atomic<bool> stop_;
+    std::chrono::steady_clock::time_point created_;  // app constructed
+    bool got_first_sample_;
+    Metrics::Counter& received_total_;
+    Metrics::Counter& parse_failures_total_;
+    Metrics::Gauge& matched_writers_;
+    Metrics::Histogram& sample_age_;
     mutable std::mutex terminate_cv_mtx_;
     std::condition_variable terminate_cv_;
 };
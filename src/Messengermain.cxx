@@ -1,17 +1,38 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
+#include <vector>
 
 #include <fastdds/dds/log/Log.hpp>
+#include "AppOptions.hpp"
+#include "AsyncLogger.hpp"
+#include "DeliveryBenchmark.hpp"
+#include "DiscoveryProfile.hpp"
 #include "MessengerApplication.hpp"
 #include "MessengerPublisherApp.hpp"
 #include "MessengerSubscriberApp.hpp"
+#include "MetricsHttpServer.hpp"
+#include "PingPong.hpp"
 #include "WebSocketServer.hpp"
 #include "SharedCoordinateState.hpp"
+#include "SharedParticipant.hpp"
+#include "SimClock.hpp"
+#include "StartupBenchmark.hpp"
+#include "StatisticsMonitor.hpp"
+#include "StatisticsProfile.hpp"
+#include "ThroughputBenchmark.hpp"
 #include "CoordinateProducer.hpp"
+#include "ThreadAffinity.hpp"
+#include "Tracer.hpp"
+#include "TransportProfile.hpp"
 
 using eprosima::fastdds::dds::Log;
 
@@ -19,7 +40,10 @@ std::function<void(int)> stop_handler;
 
 void signal_handler(int signum)
 {
-    stop_handler(signum);
+    if (stop_handler)
+    {
+        stop_handler(signum);
+    }
 }
 
 std::string parse_signal(const int& signum)
@@ -43,6 +67,8 @@ std::string parse_signal(const int& signum)
 
 int main(int argc, char** argv)
 {
+    // Startup probes report their time from here
+    auto main_started = std::chrono::steady_clock::now();
     Log::SetVerbosity(Log::Kind::Info);
     auto ret = EXIT_SUCCESS;
     int domain_id = 42;
@@ -52,15 +78,90 @@ int main(int argc, char** argv)
     std::shared_ptr<CoordinateProducer> coord_producer;
     std::shared_ptr<SharedCoordinateState> shared_state;
     
-    if (argc != 2 || (strcmp(argv[1], "publisher") != 0 && strcmp(argv[1], "subscriber") != 0))
+    AppOptions options;
+    bool valid_args = false;
+    try
+    {
+        options = AppOptions::parse(argc, argv);
+        valid_args = (options.role() == "publisher" || options.role() == "subscriber" ||
+                      options.role() == "both" || options.role() == "bench-delivery" ||
+                      options.role() == "bench-startup" || options.role() == "startup-probe" ||
+                      options.role() == "bench-throughput" || options.role() == "bench-throughput-sub" ||
+                      options.role() == "ping" || options.role() == "pong" ||
+                      options.role() == "stats-monitor" ||
+                      options.role() == "discovery-server");
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+    
+    if (!valid_args)
     {
         std::cout << "Error: Incorrect arguments." << std::endl;
         std::cout << "Usage: " << std::endl << std::endl;
-        std::cout << argv[0] << " publisher|subscriber" << std::endl << std::endl;
+        std::cout << argv[0] << " publisher|subscriber|both [options]" << std::endl;
+        std::cout << argv[0] << " bench-delivery [--modes intra,shm,udp,tcp] [--samples N] [--rate HZ] [--payload BYTES]" << std::endl;
+        std::cout << argv[0] << " bench-throughput [--duration S] [--rate HZ] [--batch N] [--payload BYTES] [--qos reliable|keep-last|best-effort] [--depth N] [--subscriber in-process|none] [--intraprocess off]" << std::endl;
+        std::cout << argv[0] << " bench-throughput-sub [--qos ...] [--depth N] [--idle-ms N]" << std::endl;
+        std::cout << argv[0] << " ping [--rates HZ,...] [--payloads BYTES,...] [--samples N] [--warmup N] [--qos reliable|best-effort] [--depth N] [--csv PATH] [--histogram-csv PREFIX]" << std::endl;
+        std::cout << argv[0] << " pong [--qos reliable|best-effort] [--depth N]" << std::endl;
+        std::cout << argv[0] << " stats-monitor [--interval-s N] [--duration S]" << std::endl;
+        std::cout << argv[0] << " bench-startup [--runs N] [--ds-local] [transport/discovery options]" << std::endl;
+        std::cout << argv[0] << " discovery-server [--discovery-server HOST:PORT]" << std::endl << std::endl;
         std::cout << std::endl;
         std::cout << "Description:" << std::endl;
         std::cout << "  publisher  - Generates figure-8 GPS coordinates and broadcasts via DDS + WebSocket" << std::endl;
         std::cout << "  subscriber - Receives coordinates from DDS and forwards to WebSocket clients" << std::endl;
+        std::cout << "  both       - Publisher and subscriber on one DomainParticipant, intra-process delivery" << std::endl;
+        std::cout << "  bench-delivery - Latency and throughput over intra-process, SHM, UDPv4 and TCPv4 loopback" << std::endl;
+        std::cout << "  bench-throughput - Sustained samples/s, MB/s, loss and CPU per sample on one writer" << std::endl;
+        std::cout << "  bench-throughput-sub - Separate-process subscriber for bench-throughput --subscriber none" << std::endl;
+        std::cout << "  ping           - Round-trip latency against a pong, per rate and payload (RTT/2 for one-way)" << std::endl;
+        std::cout << "  pong           - Echoes ping requests back until stopped" << std::endl;
+        std::cout << "  stats-monitor  - Summarizes the Fast DDS statistics topics of --dds-statistics participants" << std::endl;
+        std::cout << "  bench-startup  - Process start to first delivered sample, over fresh startup-probe processes" << std::endl;
+        std::cout << "  discovery-server - Fast DDS discovery server for --discovery-server clients (default 127.0.0.1:11811)" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  --ws-threads N             Run the WebSocket io_context on N threads (default 1)" << std::endl;
+        std::cout << "  --ws-backpressure-bytes N  Conflate a client's frames above N queued bytes (default 65536)" << std::endl;
+        std::cout << "  --ws-slowest-ms N          Slow clients down to one update per N ms based on ping RTT (default 1000, 0 = off)" << std::endl;
+        std::cout << "  --log-level LEVEL          debug|info|warn|error|off (default info)" << std::endl;
+        std::cout << "  --reactor                  Publisher: run producer, DDS and WebSocket timers on one io_context" << std::endl;
+        std::cout << "  --reactor-threads N        Threads running that io_context (default 1)" << std::endl;
+        std::cout << "  --reactor-cpu N            Pin reactor thread i to CPU N+i" << std::endl;
+        std::cout << "  --producer-hz N            Coordinate generation rate (default 50)" << std::endl;
+        std::cout << "  --producer-precise         Sleep-then-spin ticks on a dedicated thread (for 1-10 kHz)" << std::endl;
+        std::cout << "  --producer-spin-us N       Spin this long before each precise tick (default 100)" << std::endl;
+        std::cout << "  --producer-cpu N           Pin the precise producer thread to CPU N" << std::endl;
+        std::cout << "  --producer-fifo PRIO       Run the precise producer under SCHED_FIFO (needs CAP_SYS_NICE)" << std::endl;
+        std::cout << "  --producer-jitter-csv PATH Write the precise producer's tick lateness histogram" << std::endl;
+        std::cout << "  --simulate                 Publisher: virtual time, runs as fast as the pipeline can (implies --reactor)" << std::endl;
+        std::cout << "  --sim-duration S           Virtual seconds to run before stopping (default 3600)" << std::endl;
+        std::cout << "  --sim-start-ms MS          Virtual wall clock at start, ms since the epoch (default 1700000000000)" << std::endl;
+        std::cout << "  --dead-reckoning M         Publisher: send a position only when it is M metres off the extrapolated one" << std::endl;
+        std::cout << "  --dr-heartbeat-ms N        ...or N ms after the last one sent (default 1000)" << std::endl;
+        std::cout << "  --dr-horizon-ms N          Subscriber: extrapolate dead-reckoned entities for up to N ms (default 3000, 0 = off)" << std::endl;
+        std::cout << "  --trail-tolerance-m M      Subscriber: simplify TRAIL tracks to within M metres (default 5)" << std::endl;
+        std::cout << "  --trail-minutes N          Subscriber: keep N minutes of track per entity (default 10)" << std::endl;
+        std::cout << "  --history-hours N          Subscriber: keep N hours of compressed history per entity (default 6)" << std::endl;
+        std::cout << "  --transport KIND           DDS transport: default|shm|udp|tcp (default: Fast DDS builtins)" << std::endl;
+        std::cout << "  --shm-segment-bytes N      shm: shared-memory segment size" << std::endl;
+        std::cout << "  --udp-send-buffer N        udp: socket send buffer bytes" << std::endl;
+        std::cout << "  --udp-recv-buffer N        udp: socket receive buffer bytes" << std::endl;
+        std::cout << "  --tcp-port N               tcp: publisher listens on 127.0.0.1:N, subscriber connects (default 5100)" << std::endl;
+        std::cout << "  --dds-xml FILE             Load Fast DDS XML profiles; --transport overrides their transports" << std::endl;
+        std::cout << "  --dds-profile NAME         Participant profile to use from --dds-xml" << std::endl;
+        std::cout << "  --peers HOST[:PORT],...    Unicast initial peers for discovery" << std::endl;
+        std::cout << "  --discovery-server HOST:PORT  Discover through a discovery server instead of multicast" << std::endl;
+        std::cout << "  --announce-ms N            Participant announcement period" << std::endl;
+        std::cout << "  --initial-announcements N  Fast announcements right after start (with --initial-announce-ms N)" << std::endl;
+        std::cout << "  --lease-ms N               Participant lease duration" << std::endl;
+        std::cout << "  --dds-statistics [A,B,..]  Publish Fast DDS statistics (latency, throughput, resends, HEARTBEAT/ACKNACK)" << std::endl;
+        std::cout << "  --metrics-port N           Serve Prometheus metrics on http://127.0.0.1:N/metrics" << std::endl;
+        std::cout << "  --metrics-bind ADDR        Address for the metrics endpoint (default 127.0.0.1)" << std::endl;
+        std::cout << "  --trace PATH               Write per-sample spans as trace-event JSON (MESSENGER_ENABLE_TRACING builds)" << std::endl;
         std::cout << std::endl;
         std::cout << "Architecture:" << std::endl;
         std::cout << "  - CoordinateProducer: Generates coordinates at 50Hz (20ms)" << std::endl;
@@ -69,16 +170,266 @@ int main(int argc, char** argv)
         std::cout << std::endl;
         std::cout << "WebSocket Ports:" << std::endl;
         std::cout << "  Publisher:  ws://localhost:8081" << std::endl;
-        std::cout << "  Subscriber: ws://localhost:8082" << std::endl;
+        std::cout << "  Subscriber: ws://localhost:8082 (also used by both)" << std::endl;
+        std::cout << "  Binary frames: subprotocol \"coords.bin.v1\" or ws://host:port/?format=binary" << std::endl;
+        std::cout << std::endl;
+        std::cout << "WebSocket commands (text frames):" << std::endl;
+        std::cout << "  SUB [bbox=minLon,minLat,maxLon,maxLat] [ids=1,2,...] [rate=Hz]" << std::endl;
+        std::cout << "  UNSUB" << std::endl;
+        std::cout << "  RESYNC   (request a fresh snapshot after a frame sequence gap)" << std::endl;
+        std::cout << "  QUERY near=lon,lat radius=M [limit=N] [id=token]   (subscriber / both)" << std::endl;
+        std::cout << "  QUERY near=lon,lat k=N [id=token]" << std::endl;
+        std::cout << "  QUERY bbox=minLon,minLat,maxLon,maxLat [limit=N] [id=token]" << std::endl;
+        std::cout << "  TRAIL entity=N [minutes=M] [id=token]   (simplified recent track; subscriber / both)" << std::endl;
+        std::cout << "  HISTORY entity=N [from=ms] [to=ms] [minutes=M] [limit=N] [id=token]   (every sample, for replay)" << std::endl;
+        std::cout << std::endl;
+        std::cout << "HTTP (same ports):" << std::endl;
+        std::cout << "  GET /latest          Newest position of every entity" << std::endl;
+        std::cout << "  GET /entities/{id}   Newest position of one entity" << std::endl;
         ret = EXIT_FAILURE;
     }
+    else if (options.role() == "bench-delivery")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = DeliveryBenchmark::main(options);
+    }
+    else if (options.role() == "bench-throughput")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = ThroughputBenchmark::publisher_main(options);
+    }
+    else if (options.role() == "bench-throughput-sub")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = ThroughputBenchmark::subscriber_main(options);
+    }
+    else if (options.role() == "ping")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = PingPong::ping_main(options);
+    }
+    else if (options.role() == "stats-monitor")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = StatisticsMonitor::main(options);
+    }
+    else if (options.role() == "bench-startup")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = StartupBenchmark::main(argc, argv, options);
+    }
+    else if (options.role() == "startup-probe")
+    {
+        AsyncLogger::set_level(LogLevel::Warn);
+        ret = StartupBenchmark::probe(options, main_started);
+    }
     else
     {
-        bool is_publisher = (strcmp(argv[1], "publisher") == 0);
+        bool is_publisher = (options.role() == "publisher");
+        bool is_both = (options.role() == "both");
+        LogLevel log_level = LogLevel::Info;
+        if (!AsyncLogger::parse_level(options.get_string("log-level", "info"), log_level))
+        {
+            std::cout << "Unknown --log-level, using info" << std::endl;
+        }
+        AsyncLogger::set_level(log_level);
+        uint32_t ws_threads = options.get_uint("ws-threads", 1);
+        uint32_t ws_backpressure_bytes = options.get_uint("ws-backpressure-bytes", 64 * 1024);
+        uint32_t ws_slowest_ms = options.get_uint("ws-slowest-ms", 1000);
+        bool reactor = options.has("reactor");
+        uint32_t reactor_threads = std::max<uint32_t>(1, options.get_uint("reactor-threads", 1));
+        bool reactor_pin = options.has("reactor-cpu");
+        uint32_t reactor_cpu = options.get_uint("reactor-cpu", 0);
+        uint32_t producer_hz = std::max<uint32_t>(1, options.get_uint("producer-hz", 50));
+        bool producer_precise = options.has("producer-precise");
+        uint32_t producer_spin_us = options.get_uint("producer-spin-us", 100);
+        int producer_cpu = options.has("producer-cpu") ? static_cast<int>(options.get_uint("producer-cpu", 0)) : -1;
+        int producer_fifo = static_cast<int>(options.get_uint("producer-fifo", 0));
+        bool simulate = options.has("simulate");
+        uint32_t sim_duration_s = std::max<uint32_t>(1, options.get_uint("sim-duration", 3600));
+        bool dead_reckoning = options.has("dead-reckoning");
+        double dr_tolerance_m = options.get_double("dead-reckoning", 5.0);
+        uint32_t dr_heartbeat_ms = options.get_uint("dr-heartbeat-ms", 1000);
+        uint32_t dr_horizon_ms = options.get_uint("dr-horizon-ms", 3000);
+        double trail_tolerance_m = options.get_double("trail-tolerance-m", 5.0);
+        uint32_t trail_minutes = options.get_uint("trail-minutes", 10);
+        uint32_t history_hours = options.get_uint("history-hours", 6);
         
         try
         {
-            if (is_publisher)
+            TransportProfile transport = TransportProfile::from_options(options);
+            DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+            StatisticsProfile statistics = StatisticsProfile::from_options(options);
+            
+            // Scrape endpoint; the metrics themselves are always collected
+            std::unique_ptr<MetricsHttpServer> metrics_server;
+            if (options.has("metrics-port"))
+            {
+                metrics_server.reset(new MetricsHttpServer(options.get_string("metrics-bind", "127.0.0.1"),
+                                                           static_cast<uint16_t>(options.get_uint("metrics-port", 9464))));
+                metrics_server->start();
+            }
+            
+            if (options.has("trace"))
+            {
+#ifdef MESSENGER_TRACING
+                std::string trace_path = options.get_string("trace", "messenger-trace.json");
+                if (!Tracer::instance().start(trace_path))
+                {
+                    throw std::runtime_error("Cannot write trace file " + trace_path);
+                }
+#else
+                APP_LOG_WARN("Tracer") << "--trace ignored: built without -DMESSENGER_ENABLE_TRACING=ON";
+#endif
+            }
+            
+            if (options.role() == "discovery-server")
+            {
+                std::cout << "========================================" << std::endl;
+                std::cout << "   DDS DISCOVERY SERVER" << std::endl;
+                std::cout << "========================================" << std::endl;
+                
+                auto server = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_discovery_server",
+                                discovery.server_qos(transport.participant_qos(true)));
+                std::cout << "Serving discovery for domain " << domain_id << ". Press Ctrl+C to stop." << std::endl;
+                
+                std::mutex stop_mutex;
+                std::condition_variable stop_cv;
+                bool stopping = false;
+                stop_handler = [&](int signum)
+                {
+                    std::cout << "\n" << parse_signal(signum) << " received, shutting down..." << std::endl;
+                    std::lock_guard<std::mutex> lock(stop_mutex);
+                    stopping = true;
+                    stop_cv.notify_all();
+                };
+                
+                signal(SIGINT, signal_handler);
+                signal(SIGTERM, signal_handler);
+#ifndef _WIN32
+                signal(SIGQUIT, signal_handler);
+                signal(SIGHUP, signal_handler);
+#endif
+                
+                std::unique_lock<std::mutex> lock(stop_mutex);
+                stop_cv.wait(lock, [&stopping]() { return stopping; });
+            }
+            else if (options.role() == "pong")
+            {
+                std::cout << "========================================" << std::endl;
+                std::cout << "   DDS PONG" << std::endl;
+                std::cout << "========================================" << std::endl;
+                
+                // Listens when the transport is TCP; ping connects
+                auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_pong",
+                                statistics.apply(discovery.apply(transport.participant_qos(true))));
+                PingPong::Responder responder(participant, options);
+                std::cout << "Echoing \"" << PingPong::kRequestTopic << "\" to \"" << PingPong::kEchoTopic
+                          << "\" on domain " << domain_id << ". Press Ctrl+C to stop." << std::endl;
+                
+                std::mutex stop_mutex;
+                std::condition_variable stop_cv;
+                bool stopping = false;
+                stop_handler = [&](int signum)
+                {
+                    std::cout << "\n" << parse_signal(signum) << " received, shutting down..." << std::endl;
+                    std::lock_guard<std::mutex> lock(stop_mutex);
+                    stopping = true;
+                    stop_cv.notify_all();
+                };
+                
+                signal(SIGINT, signal_handler);
+                signal(SIGTERM, signal_handler);
+#ifndef _WIN32
+                signal(SIGQUIT, signal_handler);
+                signal(SIGHUP, signal_handler);
+#endif
+                
+                std::unique_lock<std::mutex> lock(stop_mutex);
+                stop_cv.wait(lock, [&stopping]() { return stopping; });
+                std::cout << "Echoed " << responder.echoed() << " requests" << std::endl;
+            }
+            else if (is_both)
+            {
+                std::cout << "========================================" << std::endl;
+                std::cout << "   COORDINATE PUBLISHER + SUBSCRIBER" << std::endl;
+                std::cout << "========================================" << std::endl;
+                std::cout << "DDS Domain ID: " << domain_id << std::endl;
+                std::cout << "DDS Topic: Movie Discussion List" << std::endl;
+                std::cout << "DDS Delivery: intra-process (one DomainParticipant)" << std::endl;
+                std::cout << "DDS Transport: " << transport.describe() << std::endl;
+                std::cout << "DDS Discovery: " << discovery.describe() << std::endl;
+                std::cout << "DDS Statistics: " << statistics.describe() << std::endl;
+                std::cout << "WebSocket: ws://localhost:8082" << std::endl;
+                std::cout << "========================================" << std::endl;
+                
+                // Samples go from the writer's history straight to the
+                // reader; discovery of the local endpoints stays in-process
+                if (!SharedParticipant::set_intraprocess(true)) {
+                    APP_LOG_WARN("Main") << "Cannot enable intra-process delivery";
+                }
+                auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_participant",
+                                                                       statistics.apply(discovery.apply(transport.participant_qos(true))));
+                
+                shared_state = std::make_shared<SharedCoordinateState>();
+                coord_producer = std::make_shared<CoordinateProducer>(
+                    shared_state, std::chrono::microseconds(1000000 / producer_hz));
+                if (producer_precise) {
+                    coord_producer->enable_precise(std::chrono::microseconds(producer_spin_us),
+                                                   producer_cpu, producer_fifo,
+                                                   options.get_string("producer-jitter-csv"));
+                }
+                
+                auto pub_app = std::make_shared<MessengerPublisherApp>(participant);
+                pub_app->set_shared_state(shared_state);
+                if (dead_reckoning) {
+                    pub_app->set_dead_reckoning(dr_tolerance_m, dr_heartbeat_ms);
+                }
+                auto sub_app = std::make_shared<MessengerSubscriberApp>(participant);
+                sub_app->set_dead_reckoning_horizon(dr_horizon_ms);
+                sub_app->trail_store()->configure(trail_tolerance_m, trail_minutes * 60);
+                sub_app->history_store()->set_retention(history_hours * 3600);
+                
+                // The WebSocket side only sees what came through DDS
+                ws_server = std::make_shared<WebSocketServer>(50, ws_threads);
+                ws_server->set_backpressure_threshold(ws_backpressure_bytes);
+                ws_server->set_adaptive_rate(ws_slowest_ms);
+                sub_app->set_websocket_server(ws_server);
+                ws_server->set_spatial_index(sub_app->spatial_index());
+                ws_server->set_trail_store(sub_app->trail_store());
+                ws_server->set_history_store(sub_app->history_store());
+                
+                std::vector<std::thread> threads;
+                threads.emplace_back(&CoordinateProducer::run, coord_producer);
+                threads.emplace_back(&MessengerPublisherApp::run, pub_app);
+                threads.emplace_back(&MessengerSubscriberApp::run, sub_app);
+                threads.emplace_back([ws_server]{ ws_server->run(8082); });
+                
+                std::cout << std::endl;
+                std::cout << "System running. Press Ctrl+C to stop." << std::endl;
+                std::cout << std::endl;
+                
+                stop_handler = [&](int signum)
+                {
+                    std::cout << "\n" << parse_signal(signum) << " received, shutting down..." << std::endl;
+                    coord_producer->stop();
+                    pub_app->stop();
+                    sub_app->stop();
+                    ws_server->stop();
+                };
+                
+                signal(SIGINT, signal_handler);
+                signal(SIGTERM, signal_handler);
+#ifndef _WIN32
+                signal(SIGQUIT, signal_handler);
+                signal(SIGHUP, signal_handler);
+#endif
+                
+                for (auto& t : threads) {
+                    t.join();
+                }
+            }
+            else if (is_publisher)
             {
                 std::cout << "========================================" << std::endl;
                 std::cout << "   COORDINATE PUBLISHER SYSTEM" << std::endl;
@@ -86,45 +437,154 @@ int main(int argc, char** argv)
                 std::cout << "Architecture: Producer-Consumer Model" << std::endl;
                 std::cout << "DDS Domain ID: " << domain_id << std::endl;
                 std::cout << "DDS Topic: Movie Discussion List" << std::endl;
+                std::cout << "DDS Transport: " << transport.describe() << std::endl;
+                std::cout << "DDS Discovery: " << discovery.describe() << std::endl;
+                std::cout << "DDS Statistics: " << statistics.describe() << std::endl;
                 std::cout << std::endl;
                 
                 // 1. Tạo shared state
                 shared_state = std::make_shared<SharedCoordinateState>();
                 
-                // 2. Tạo coordinate producer (50Hz)
+                // Virtual time needs every timer on one wheel and one thread
+                if (simulate)
+                {
+                    if (producer_precise)
+                    {
+                        throw std::runtime_error("--simulate ticks the producer from the timing wheel; "
+                                                 "drop --producer-precise");
+                    }
+                    reactor = true;
+                    reactor_threads = 1;
+                    int64_t sim_start_ms = static_cast<int64_t>(options.get_double("sim-start-ms", 1700000000000.0));
+                    SimClock::enable_virtual(sim_start_ms);
+                    std::cout << "Simulation: " << sim_duration_s << " s of virtual time from " << sim_start_ms
+                              << " ms, as fast as the pipeline runs" << std::endl;
+                }
+                
+                // Reactor mode: every component schedules its periodic work
+                // on one timing wheel instead of running its own loop thread
+                asio::io_context reactor_io;
+                TimingWheel reactor_wheel(reactor_io);
+                TimingWheel* shared_wheel = reactor ? &reactor_wheel : nullptr;
+                
+                // 2. Tạo coordinate producer (50Hz mặc định)
                 coord_producer = std::make_shared<CoordinateProducer>(
                     shared_state,
-                    std::chrono::milliseconds(20),  // 50Hz
+                    std::chrono::microseconds(1000000 / producer_hz),
                     107.02243,  // center_lon
-                    20.76300    // center_lat
+                    20.76300,   // center_lat
+                    producer_precise ? nullptr : shared_wheel  // precise ticks need their own thread
                 );
+                if (producer_precise) {
+                    coord_producer->enable_precise(std::chrono::microseconds(producer_spin_us),
+                                                   producer_cpu, producer_fifo,
+                                                   options.get_string("producer-jitter-csv"));
+                }
                 
                 // 3. Tạo DDS publisher app (20Hz)
-                app = MessengerApplication::make_app(domain_id, argv[1]);
-                auto pub_app = std::dynamic_pointer_cast<MessengerPublisherApp>(app);
-                if (pub_app) {
-                    pub_app->set_shared_state(shared_state);
+                // The publisher is the listening side over TCP
+                auto pub_app = std::make_shared<MessengerPublisherApp>(std::make_shared<SharedParticipant>(
+                    domain_id, "Messenger::Message_pub_participant", statistics.apply(discovery.apply(transport.participant_qos(true)))));
+                app = pub_app;
+                pub_app->set_shared_state(shared_state);
+                if (dead_reckoning) {
+                    pub_app->set_dead_reckoning(dr_tolerance_m, dr_heartbeat_ms);
                 }
                 
                 // 4. Tạo WebSocket server (10Hz)
-                ws_server = std::make_shared<WebSocketServer>(100); // 10Hz
+                ws_server = std::make_shared<WebSocketServer>(100, reactor ? reactor_threads : ws_threads); // 10Hz
                 ws_server->set_shared_state(shared_state);
+                ws_server->set_backpressure_threshold(ws_backpressure_bytes);
+                ws_server->set_adaptive_rate(ws_slowest_ms);
                 
                 std::cout << "Components:" << std::endl;
-                std::cout << "  [1] CoordinateProducer: 50Hz (generates coordinates)" << std::endl;
-                std::cout << "  [2] DDS Publisher:      20Hz (publishes to DDS)" << std::endl;
+                std::cout << "  [1] CoordinateProducer: " << producer_hz << "Hz (generates coordinates"
+                          << (producer_precise ? ", precise ticks)" : ")") << std::endl;
+                std::cout << "  [2] DDS Publisher:      20Hz (publishes to DDS";
+                if (dead_reckoning) {
+                    std::cout << ", dead reckoning " << dr_tolerance_m << " m / " << dr_heartbeat_ms << " ms";
+                }
+                std::cout << ")" << std::endl;
                 std::cout << "  [3] WebSocket Server:   10Hz (broadcasts to clients + handles connections)" << std::endl;
                 std::cout << "  [4] Shared State:       Atomic thread-safe buffer" << std::endl;
+                if (reactor) {
+                    std::cout << "  Execution: single reactor, " << reactor_threads << " thread(s)" << std::endl;
+                }
                 std::cout << std::endl;
                 std::cout << "WebSocket: ws://localhost:8081" << std::endl;
                 std::cout << "Pattern: Figure-8 trajectory" << std::endl;
                 std::cout << "Center: [107.02243, 20.76300]" << std::endl;
                 std::cout << "========================================" << std::endl;
                 
+                auto shutdown = [&]()
+                {
+                    coord_producer->stop();
+                    app->stop();
+                    ws_server->stop();
+                    reactor_wheel.stop();
+                    reactor_io.stop();
+                };
+                
+                // ws_server and the apps live in main's scope, but start()
+                // binds them to this block's io_context and wheel: release
+                // them, and the handler that refers to these locals, before
+                // those go away (also when start() throws)
+                struct ReactorScope {
+                    std::function<void()> release;
+                    ~ReactorScope() { release(); }
+                } reactor_scope{[&]() {
+                    stop_handler = nullptr;
+                    ws_server.reset();
+                    app.reset();
+                    coord_producer.reset();
+                }};
+                
+                // Before the threads start: virtual time can reach it at once
+                if (simulate) {
+                    auto wall_started = std::chrono::steady_clock::now();
+                    reactor_wheel.schedule_once("sim-end", std::chrono::seconds(sim_duration_s),
+                        [&shutdown, wall_started, sim_duration_s]() {
+                            double wall_s = std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - wall_started).count() / 1e6;
+                            std::cout << "Simulated " << sim_duration_s << " s in " << wall_s << " s ("
+                                      << (wall_s > 0.0 ? sim_duration_s / wall_s : 0.0) << "x real time)"
+                                      << std::endl;
+                            shutdown();
+                        });
+                }
+                
                 // Start threads
-                std::thread producer_thread(&CoordinateProducer::run, coord_producer);
-                std::thread dds_thread(&MessengerApplication::run, app);
-                std::thread ws_thread([ws_server]{ ws_server->run(8081); });
+                std::vector<std::thread> threads;
+                if (reactor) {
+                    if (producer_precise) {
+                        threads.emplace_back(&CoordinateProducer::run, coord_producer);
+                    } else {
+                        coord_producer->start();
+                    }
+                    if (pub_app) {
+                        pub_app->start(reactor_wheel);
+                    }
+                    ws_server->start(8081, reactor_wheel);
+                    
+                    for (uint32_t i = 0; i < reactor_threads; ++i) {
+                        threads.emplace_back([&reactor_io, reactor_pin, reactor_cpu, i]() {
+                            if (reactor_pin) {
+                                unsigned cpu = reactor_cpu + i;
+                                std::string error = pin_current_thread(cpu);
+                                if (!error.empty()) {
+                                    APP_LOG_WARN("Reactor") << "Pinning to CPU " << cpu << " failed: " << error;
+                                } else {
+                                    APP_LOG_INFO("Reactor") << "Thread " << i << " pinned to CPU " << cpu;
+                                }
+                            }
+                            reactor_io.run();
+                        });
+                    }
+                } else {
+                    threads.emplace_back(&CoordinateProducer::run, coord_producer);
+                    threads.emplace_back(&MessengerApplication::run, app);
+                    threads.emplace_back([ws_server]{ ws_server->run(8081); });
+                }
                 
                 std::cout << std::endl;
                 std::cout << "System running. Press Ctrl+C to stop." << std::endl;
@@ -134,9 +594,7 @@ int main(int argc, char** argv)
                 stop_handler = [&](int signum)
                 {
                     std::cout << "\n" << parse_signal(signum) << " received, shutting down..." << std::endl;
-                    coord_producer->stop();
-                    app->stop();
-                    ws_server->stop();
+                    shutdown();
                 };
                 
                 signal(SIGINT, signal_handler);
@@ -147,9 +605,9 @@ int main(int argc, char** argv)
 #endif
                 
                 // Wait for threads
-                producer_thread.join();
-                dds_thread.join();
-                ws_thread.join();
+                for (auto& t : threads) {
+                    t.join();
+                }
             }
             else  // subscriber
             {
@@ -158,26 +616,38 @@ int main(int argc, char** argv)
                 std::cout << "========================================" << std::endl;
                 std::cout << "DDS Domain ID: " << domain_id << std::endl;
                 std::cout << "DDS Topic: Movie Discussion List" << std::endl;
+                std::cout << "DDS Transport: " << transport.describe() << std::endl;
+                std::cout << "DDS Discovery: " << discovery.describe() << std::endl;
+                std::cout << "DDS Statistics: " << statistics.describe() << std::endl;
                 std::cout << "WebSocket: ws://localhost:8082" << std::endl;
                 std::cout << "Mode: Receive & Forward" << std::endl;
                 std::cout << "========================================" << std::endl;
                 
-                // Tạo DDS application
-                app = MessengerApplication::make_app(domain_id, argv[1]);
+                // Tạo DDS application (connects to the publisher over TCP)
+                app = std::make_shared<MessengerSubscriberApp>(std::make_shared<SharedParticipant>(
+                    domain_id, "Messenger::Message_sub_participant", statistics.apply(discovery.apply(transport.participant_qos(false)))));
                 
                 // Khởi tạo WebSocket server
-                // ws_server = std::make_shared<WebSocketServer>();
+                ws_server = std::make_shared<WebSocketServer>(50, ws_threads);
+                ws_server->set_backpressure_threshold(ws_backpressure_bytes);
+                ws_server->set_adaptive_rate(ws_slowest_ms);
                 
                 auto sub_app = std::dynamic_pointer_cast<MessengerSubscriberApp>(app);
                 if (sub_app) {
                     sub_app->set_websocket_server(ws_server);
+                    sub_app->set_dead_reckoning_horizon(dr_horizon_ms);
+                    sub_app->trail_store()->configure(trail_tolerance_m, trail_minutes * 60);
+                    sub_app->history_store()->set_retention(history_hours * 3600);
+                    ws_server->set_spatial_index(sub_app->spatial_index());
+                    ws_server->set_trail_store(sub_app->trail_store());
+                    ws_server->set_history_store(sub_app->history_store());
                 }
                 
                 // Chạy DDS app thread
                 std::thread app_thread(&MessengerApplication::run, app);
                 
                 // Chạy WebSocket server thread
-                // std::thread ws_thread([ws_server]{ ws_server->run(8082); });
+                std::thread ws_thread([ws_server]{ ws_server->run(8082); });
                 
                 std::cout << std::endl;
                 std::cout << "System running. Press Ctrl+C to stop." << std::endl;
@@ -200,18 +670,20 @@ int main(int argc, char** argv)
                 
                 // Wait for threads
                 app_thread.join();
-                // ws_thread.join();
+                ws_thread.join();
             }
             
+            Tracer::instance().stop();
             std::cout << "Shutdown complete." << std::endl;
         }
-        catch (const std::runtime_error& e)
+        catch (const std::exception& e)  // also websocketpp::exception, e.g. port in use
         {
             EPROSIMA_LOG_ERROR(app_name, e.what());
             ret = EXIT_FAILURE;
         }
     }
     
+    AsyncLogger::instance().shutdown();
     Log::Reset();
     return ret;
 }
\ No newline at end of file
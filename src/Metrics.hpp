@@ -0,0 +1,239 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process-wide metrics in the Prometheus text exposition format.
+//
+// Components look their metrics up once (registration takes a lock) and
+// keep the reference; updating a Counter, Gauge or Histogram afterwards is
+// a few relaxed atomic operations and never blocks. Metrics live as long as
+// the process. Looking up a name again returns the same metric, so two
+// instances of a component add up.
+//
+//   static Counter& sent = Metrics::counter("messenger_x_total", "Things sent");
+//   sent.inc();
+namespace Metrics {
+
+class Counter {
+private:
+    std::atomic<uint64_t> value_;
+
+public:
+    Counter() : value_(0) {}
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+class Gauge {
+private:
+    std::atomic<int64_t> value_;
+
+public:
+    Gauge() : value_(0) {}
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+    void inc() { add(1); }
+    void dec() { add(-1); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+};
+
+// Fixed buckets (upper bounds, in the metric's unit, usually seconds)
+class Histogram {
+private:
+    std::vector<double> bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;  // bounds_.size() + 1 (+Inf)
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_bits_;  // double, updated with CAS
+
+    static uint64_t to_bits(double v) {
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+
+    static double from_bits(uint64_t bits) {
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+public:
+    explicit Histogram(const std::vector<double>& bounds)
+        : bounds_(bounds)
+        , counts_(new std::atomic<uint64_t>[bounds.size() + 1])
+        , count_(0)
+        , sum_bits_(to_bits(0.0))
+    {
+        for (size_t i = 0; i <= bounds_.size(); ++i) {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds_.size() && v > bounds_[i]) {
+            ++i;
+        }
+        counts_[i].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t old_bits = sum_bits_.load(std::memory_order_relaxed);
+        while (!sum_bits_.compare_exchange_weak(old_bits, to_bits(from_bits(old_bits) + v),
+                                                std::memory_order_relaxed)) {
+        }
+    }
+
+    const std::vector<double>& bounds() const { return bounds_; }
+    uint64_t bucket(size_t i) const { return counts_[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    double sum() const { return from_bits(sum_bits_.load(std::memory_order_relaxed)); }
+
+    // 1-2-5 steps from `first` up to `last`, e.g. exponential(1e-6, 1.0)
+    static std::vector<double> exponential(double first, double last) {
+        std::vector<double> bounds;
+        const double steps[] = {1.0, 2.0, 5.0};
+        for (double decade = first; decade <= last * 1.0001; decade *= 10.0) {
+            for (double step : steps) {
+                if (decade * step <= last * 1.0001) {
+                    bounds.push_back(decade * step);
+                }
+            }
+        }
+        return bounds;
+    }
+};
+
+class Registry {
+private:
+    enum Kind { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Family {
+        Kind kind;
+        std::string help;
+        // by label set, e.g. `task="producer"` or "" for none
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    Family& family(const std::string& name, const std::string& help, Kind kind) {
+        auto it = families_.find(name);
+        if (it == families_.end()) {
+            Family f;
+            f.kind = kind;
+            f.help = help;
+            it = families_.insert(std::make_pair(name, std::move(f))).first;
+        }
+        return it->second;
+    }
+
+    static std::string series(const std::string& name, const std::string& labels,
+                              const std::string& extra = "") {
+        std::string joined = labels;
+        if (!extra.empty()) {
+            joined += joined.empty() ? extra : "," + extra;
+        }
+        return joined.empty() ? name : name + "{" + joined + "}";
+    }
+
+    static std::string number(double v) {
+        if (v == std::numeric_limits<double>::infinity()) {
+            return "+Inf";
+        }
+        char text[32];
+        snprintf(text, sizeof(text), "%.9g", v);
+        return text;
+    }
+
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, COUNTER).counters[labels];
+        if (!slot) {
+            slot.reset(new Counter());
+        }
+        return *slot;
+    }
+
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, GAUGE).gauges[labels];
+        if (!slot) {
+            slot.reset(new Gauge());
+        }
+        return *slot;
+    }
+
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         const std::vector<double>& bounds, const std::string& labels = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& slot = family(name, help, HISTOGRAM).histograms[labels];
+        if (!slot) {
+            slot.reset(new Histogram(bounds));
+        }
+        return *slot;
+    }
+
+    // Text exposition format 0.0.4
+    std::string render() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out;
+        for (const auto& entry : families_) {
+            const std::string& name = entry.first;
+            const Family& f = entry.second;
+            out += "# HELP " + name + " " + f.help + "\n";
+            out += "# TYPE " + name + (f.kind == COUNTER ? " counter\n" : f.kind == GAUGE ? " gauge\n" : " histogram\n");
+            for (const auto& c : f.counters) {
+                out += series(name, c.first) + " " + std::to_string(c.second->value()) + "\n";
+            }
+            for (const auto& g : f.gauges) {
+                out += series(name, g.first) + " " + std::to_string(g.second->value()) + "\n";
+            }
+            for (const auto& h : f.histograms) {
+                const Histogram& hist = *h.second;
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= hist.bounds().size(); ++i) {
+                    cumulative += hist.bucket(i);
+                    double le = i < hist.bounds().size() ? hist.bounds()[i] : std::numeric_limits<double>::infinity();
+                    out += series(name + "_bucket", h.first, "le=\"" + number(le) + "\"") + " " +
+                           std::to_string(cumulative) + "\n";
+                }
+                out += series(name + "_sum", h.first) + " " + number(hist.sum()) + "\n";
+                out += series(name + "_count", h.first) + " " + std::to_string(hist.count()) + "\n";
+            }
+        }
+        return out;
+    }
+};
+
+inline Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+inline Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+    return registry().counter(name, help, labels);
+}
+
+inline Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+    return registry().gauge(name, help, labels);
+}
+
+// Seconds, 1 µs .. 10 s unless other bounds are given
+inline Histogram& histogram(const std::string& name, const std::string& help,
+                            const std::vector<double>& bounds = Histogram::exponential(1e-6, 10.0),
+                            const std::string& labels = "") {
+    return registry().histogram(name, help, bounds, labels);
+}
+
+} // namespace Metrics
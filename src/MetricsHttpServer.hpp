@@ -0,0 +1,96 @@
+#pragma once
+#define ASIO_STANDALONE
+#include <asio.hpp>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "AsyncLogger.hpp"
+#include "Metrics.hpp"
+
+// Serves GET /metrics (Prometheus text format) from its own thread, so a
+// scrape never waits behind the pipeline and the pipeline never waits
+// behind a scrape. One request per connection; anything else gets a 404.
+class MetricsHttpServer {
+private:
+    typedef asio::ip::tcp tcp;
+
+    asio::io_context io_;
+    tcp::acceptor acceptor_;
+    std::thread thread_;
+
+    void accept() {
+        auto socket = std::make_shared<tcp::socket>(io_);
+        acceptor_.async_accept(*socket, [this, socket](const asio::error_code& ec) {
+            if (!acceptor_.is_open()) {
+                return;
+            }
+            if (!ec) {
+                serve(socket);
+            }
+            accept();
+        });
+    }
+
+    void serve(std::shared_ptr<tcp::socket> socket) {
+        auto request = std::make_shared<asio::streambuf>(8192);
+        asio::async_read_until(*socket, *request, "\r\n\r\n",
+            [socket, request](const asio::error_code& ec, size_t /*bytes*/) {
+                if (ec) {
+                    return;
+                }
+                std::istream in(request.get());
+                std::string method;
+                std::string target;
+                in >> method >> target;
+
+                std::string status = "200 OK";
+                std::string type = "text/plain; version=0.0.4; charset=utf-8";
+                std::string body;
+                if (method != "GET") {
+                    status = "405 Method Not Allowed";
+                    body = "GET only\n";
+                } else if (target == "/metrics" || target.compare(0, 9, "/metrics?") == 0) {
+                    body = Metrics::registry().render();
+                } else {
+                    status = "404 Not Found";
+                    body = "Try /metrics\n";
+                }
+
+                auto response = std::make_shared<std::string>(
+                    "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+                    "\r\nContent-Length: " + std::to_string(body.size()) +
+                    "\r\nConnection: close\r\n\r\n" + body);
+                asio::async_write(*socket, asio::buffer(*response),
+                    [socket, response](const asio::error_code& /*ec*/, size_t /*bytes*/) {
+                        asio::error_code ignored;
+                        socket->shutdown(tcp::socket::shutdown_both, ignored);
+                    });
+            });
+    }
+
+public:
+    // Throws asio::system_error if the address cannot be bound
+    MetricsHttpServer(const std::string& bind_address, uint16_t port)
+        : acceptor_(io_, tcp::endpoint(asio::ip::make_address(bind_address), port))
+    {}
+
+    ~MetricsHttpServer() {
+        stop();
+    }
+
+    void start() {
+        accept();
+        thread_ = std::thread([this]() { io_.run(); });
+        APP_LOG_INFO("Metrics") << "Serving http://" << acceptor_.local_endpoint().address().to_string()
+                                << ":" << acceptor_.local_endpoint().port() << "/metrics";
+    }
+
+    // Safe to call more than once; the acceptor closes with the server
+    void stop() {
+        io_.stop();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+};
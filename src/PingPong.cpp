@@ -0,0 +1,454 @@
+#include "PingPong.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fastdds/dds/core/status/PublicationMatchedStatus.hpp>
+#include <fastdds/dds/core/status/SubscriptionMatchedStatus.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+
+#include "DiscoveryProfile.hpp"
+#include "LatencyHistogram.hpp"
+#include "Messenger.hpp"
+#include "MessengerPubSubTypes.hpp"
+#include "StatisticsProfile.hpp"
+#include "TransportProfile.hpp"
+
+using namespace eprosima::fastdds::dds;
+
+const char* const PingPong::kRequestTopic = "Messenger Ping";
+const char* const PingPong::kEchoTopic = "Messenger Pong";
+
+namespace {
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Both sides use the same QoS, otherwise the endpoints do not match
+DataWriterQos make_writer_qos(
+        bool reliable,
+        int32_t depth)
+{
+    DataWriterQos qos = DATAWRITER_QOS_DEFAULT;
+    qos.reliability().kind = reliable ? ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS
+                                      : ReliabilityQosPolicyKind::BEST_EFFORT_RELIABILITY_QOS;
+    qos.history().kind = HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+    qos.history().depth = depth;
+    qos.data_sharing().off();
+    return qos;
+}
+
+DataReaderQos make_reader_qos(
+        bool reliable,
+        int32_t depth)
+{
+    DataReaderQos qos = DATAREADER_QOS_DEFAULT;
+    qos.reliability().kind = reliable ? ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS
+                                      : ReliabilityQosPolicyKind::BEST_EFFORT_RELIABILITY_QOS;
+    qos.history().kind = HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+    qos.history().depth = depth;
+    qos.data_sharing().off();
+    return qos;
+}
+
+bool parse_reliable(
+        const AppOptions& options)
+{
+    std::string qos = options.get_string("qos", "reliable");
+    if (qos != "reliable" && qos != "best-effort")
+    {
+        throw std::runtime_error("Unknown --qos: " + qos + " (reliable|best-effort)");
+    }
+    return qos == "reliable";
+}
+
+int32_t parse_depth(
+        const AppOptions& options)
+{
+    return static_cast<int32_t>(std::max<uint32_t>(1, options.get_uint("depth", 100)));
+}
+
+std::vector<uint32_t> parse_list(
+        const std::string& text,
+        const char* option)
+{
+    std::vector<uint32_t> values;
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ','))
+    {
+        char* end = nullptr;
+        unsigned long value = strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value == 0)
+        {
+            throw std::runtime_error(std::string("Bad --") + option + " value: " + item);
+        }
+        values.push_back(static_cast<uint32_t>(value));
+    }
+    if (values.empty())
+    {
+        throw std::runtime_error(std::string("Empty --") + option);
+    }
+    return values;
+}
+
+struct Result
+{
+    uint32_t rate_hz;
+    uint32_t payload_bytes;
+    uint32_t sent;      // measured samples, warm-up excluded
+    uint32_t received;
+    LatencyHistogram rtt_ns;
+};
+
+// Sends requests and times the echoes
+class Pinger : public DataReaderListener
+{
+public:
+
+    Pinger(
+            std::shared_ptr<SharedParticipant> participant,
+            bool reliable,
+            int32_t depth,
+            uint32_t samples,
+            uint32_t warmup,
+            uint32_t timeout_ms)
+        : participant_(participant)
+        , samples_(samples)
+        , warmup_(warmup)
+        , timeout_ms_(timeout_ms)
+        , base_(0)
+        , next_count_(0)
+        , received_(0)
+    {
+        TypeSupport type(new Messenger::MessagePubSubType());
+        publisher_ = participant_->get()->create_publisher(PUBLISHER_QOS_DEFAULT);
+        subscriber_ = participant_->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+        writer_ = publisher_ ? publisher_->create_datawriter(participant_->topic(PingPong::kRequestTopic, type),
+                        make_writer_qos(reliable, depth)) : nullptr;
+        reader_ = subscriber_ ? subscriber_->create_datareader(participant_->topic(PingPong::kEchoTopic, type),
+                        make_reader_qos(reliable, depth), this) : nullptr;
+        if (writer_ == nullptr || reader_ == nullptr)
+        {
+            throw std::runtime_error("Ping DataWriter/DataReader initialization failed");
+        }
+    }
+
+    ~Pinger()
+    {
+        reader_->set_listener(nullptr);
+        subscriber_->delete_datareader(reader_);
+        publisher_->delete_datawriter(writer_);
+        participant_->get()->delete_subscriber(subscriber_);
+        participant_->get()->delete_publisher(publisher_);
+    }
+
+    //! Both directions matched, i.e. a pong is up
+    bool wait_for_pong(
+            uint32_t timeout_s)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_s);
+        PublicationMatchedStatus pub;
+        SubscriptionMatchedStatus sub;
+        do
+        {
+            writer_->get_publication_matched_status(pub);
+            reader_->get_subscription_matched_status(sub);
+            if (pub.current_count > 0 && sub.current_count > 0)
+            {
+                // The pong side may see the match a moment later
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } while (std::chrono::steady_clock::now() < deadline);
+        return false;
+    }
+
+    Result run(
+            uint32_t rate_hz,
+            uint32_t payload_bytes)
+    {
+        uint32_t total = warmup_ + samples_;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Counts keep growing across runs, so late echoes of an earlier run are ignored
+            base_ = next_count_;
+            next_count_ += total;
+            sent_ns_.assign(total, 0);
+            rtt_ns_.reset();
+            received_ = 0;
+        }
+
+        Messenger::Message sample;
+        sample.from("ping");
+        sample.subject("rtt");
+        sample.subject_id(1);
+        sample.text(std::string(payload_bytes, 'x'));
+
+        std::chrono::nanoseconds period(1000000000LL / rate_hz);
+        auto next = std::chrono::steady_clock::now();
+        uint32_t sent = 0;
+        for (uint32_t i = 0; i < total; ++i)
+        {
+            sample.count(static_cast<int32_t>(base_ + i));
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                sent_ns_[i] = now_ns();
+            }
+            if (RETCODE_OK == writer_->write(&sample) && i >= warmup_)
+            {
+                sent++;
+            }
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+
+        Result result;
+        result.rate_hz = rate_hz;
+        result.payload_bytes = payload_bytes;
+        result.sent = sent;
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms_), [this, sent]() { return received_ >= sent; });
+        result.received = received_;
+        result.rtt_ns = rtt_ns_;
+        // Whatever arrives from now on is dropped by the next run's base
+        sent_ns_.assign(total, 0);
+        return result;
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        Messenger::Message sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            int64_t now = now_ns();
+            if (!info.valid_data)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            int64_t index = static_cast<int64_t>(sample.count()) - base_;
+            if (index < static_cast<int64_t>(warmup_) || index >= static_cast<int64_t>(sent_ns_.size()) ||
+                    sent_ns_[index] == 0)
+            {
+                continue;
+            }
+            rtt_ns_.record(now - sent_ns_[index]);
+            sent_ns_[index] = 0;  // a duplicate is not a second sample
+            received_++;
+            cv_.notify_all();
+        }
+    }
+
+private:
+
+    std::shared_ptr<SharedParticipant> participant_;
+    Publisher* publisher_;
+    DataWriter* writer_;
+    Subscriber* subscriber_;
+    DataReader* reader_;
+    uint32_t samples_;
+    uint32_t warmup_;
+    uint32_t timeout_ms_;
+
+    std::mutex mutex_;              // guards everything below
+    std::condition_variable cv_;
+    int64_t base_;
+    int64_t next_count_;
+    std::vector<int64_t> sent_ns_;  // by count - base_, 0 once answered
+    LatencyHistogram rtt_ns_;
+    uint32_t received_;
+};
+
+std::string format(
+        const Result& result)
+{
+    char line[384];
+    uint32_t lost = result.sent > result.received ? result.sent - result.received : 0;
+    snprintf(line, sizeof(line), "%u Hz, %u bytes: %u/%u echoed (%u lost), RTT %s; RTT/2 p50=%.1f p99=%.1f us",
+             result.rate_hz, result.payload_bytes, result.received, result.sent, lost,
+             result.rtt_ns.summary("ns").c_str(), result.rtt_ns.percentile(50) / 2000.0,
+             result.rtt_ns.percentile(99) / 2000.0);
+    return line;
+}
+
+} // namespace
+
+PingPong::Responder::Responder(
+        std::shared_ptr<SharedParticipant> participant,
+        const AppOptions& options)
+    : participant_(participant)
+    , publisher_(nullptr)
+    , writer_(nullptr)
+    , subscriber_(nullptr)
+    , reader_(nullptr)
+    , echoed_(0)
+{
+    bool reliable = parse_reliable(options);
+    int32_t depth = parse_depth(options);
+    TypeSupport type(new Messenger::MessagePubSubType());
+    publisher_ = participant_->get()->create_publisher(PUBLISHER_QOS_DEFAULT);
+    subscriber_ = participant_->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+    // Writer first, so the first request already has somewhere to go
+    writer_ = publisher_ ? publisher_->create_datawriter(participant_->topic(kEchoTopic, type),
+                    make_writer_qos(reliable, depth)) : nullptr;
+    reader_ = (subscriber_ && writer_) ? subscriber_->create_datareader(participant_->topic(kRequestTopic, type),
+                    make_reader_qos(reliable, depth), this) : nullptr;
+    if (writer_ == nullptr || reader_ == nullptr)
+    {
+        throw std::runtime_error("Pong DataWriter/DataReader initialization failed");
+    }
+}
+
+PingPong::Responder::~Responder()
+{
+    reader_->set_listener(nullptr);
+    subscriber_->delete_datareader(reader_);
+    publisher_->delete_datawriter(writer_);
+    participant_->get()->delete_subscriber(subscriber_);
+    participant_->get()->delete_publisher(publisher_);
+}
+
+void PingPong::Responder::on_data_available(
+        DataReader* reader)
+{
+    Messenger::Message sample;
+    SampleInfo info;
+    while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+    {
+        if (info.valid_data && RETCODE_OK == writer_->write(&sample))
+        {
+            echoed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+int PingPong::ping_main(
+        const AppOptions& options)
+{
+    try
+    {
+        int domain_id = static_cast<int>(options.get_uint("domain", 42));
+        std::vector<uint32_t> rates = parse_list(options.get_string("rates", "100,1000"), "rates");
+        std::vector<uint32_t> payloads = parse_list(options.get_string("payloads", "64,1024,16384"), "payloads");
+        uint32_t samples = std::max<uint32_t>(1, options.get_uint("samples", 5000));
+        uint32_t warmup = options.get_uint("warmup", 100);
+        int32_t depth = parse_depth(options);
+        uint32_t timeout_ms = options.get_uint("timeout-ms", 2000);
+        bool reliable = parse_reliable(options);
+        std::string csv_path = options.get_string("csv", "");
+        std::string histogram_prefix = options.get_string("histogram-csv", "");
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+        StatisticsProfile statistics = StatisticsProfile::from_options(options);
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "   DDS PING (round trip via pong)" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << samples << " samples per run after " << warmup << " warm-up, QoS "
+                  << (reliable ? "reliable" : "best-effort") << ", domain " << domain_id << std::endl;
+        std::cout << "Transport: " << transport.describe() << ", discovery: " << discovery.describe() << std::endl;
+
+        // pong listens when the transport is TCP
+        auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_ping",
+                        statistics.apply(discovery.apply(transport.participant_qos(false))));
+        Pinger pinger(participant, reliable, depth, samples, warmup, timeout_ms);
+        std::cout << "Waiting for pong on \"" << kRequestTopic << "\"..." << std::endl;
+        if (!pinger.wait_for_pong(options.get_uint("match-timeout-s", 30)))
+        {
+            throw std::runtime_error("No pong matched; start `Messenger pong` with the same --qos and --depth");
+        }
+
+        std::vector<Result> results;
+        for (uint32_t rate : rates)
+        {
+            for (uint32_t payload : payloads)
+            {
+                results.push_back(pinger.run(rate, payload));
+                std::cout << format(results.back()) << std::endl;
+            }
+        }
+        std::cout << "========================================" << std::endl;
+
+        if (!csv_path.empty())
+        {
+            FILE* out = fopen(csv_path.c_str(), "w");
+            if (out == nullptr)
+            {
+                throw std::runtime_error("Cannot write " + csv_path);
+            }
+            fprintf(out, "rate_hz,payload_bytes,sent,received,lost,rtt_min_ns,rtt_p50_ns,rtt_p90_ns,"
+                    "rtt_p99_ns,rtt_p999_ns,rtt_max_ns,rtt_mean_ns,half_rtt_p50_ns,half_rtt_p99_ns\n");
+            for (const Result& r : results)
+            {
+                fprintf(out, "%u,%u,%u,%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%.1f,%llu,%llu\n",
+                        r.rate_hz, r.payload_bytes, r.sent, r.received,
+                        r.sent > r.received ? r.sent - r.received : 0,
+                        static_cast<unsigned long long>(r.rtt_ns.min()),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(50)),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(90)),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(99)),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(99.9)),
+                        static_cast<unsigned long long>(r.rtt_ns.max()),
+                        r.rtt_ns.mean(),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(50) / 2),
+                        static_cast<unsigned long long>(r.rtt_ns.percentile(99) / 2));
+            }
+            fclose(out);
+            std::cout << "Summary: " << csv_path << std::endl;
+        }
+        if (!histogram_prefix.empty())
+        {
+            // One RTT histogram (ns) per rate and payload
+            for (const Result& r : results)
+            {
+                std::string path = histogram_prefix + "_" + std::to_string(r.rate_hz) + "hz_" +
+                        std::to_string(r.payload_bytes) + "b.csv";
+                FILE* out = fopen(path.c_str(), "w");
+                if (out == nullptr)
+                {
+                    throw std::runtime_error("Cannot write " + path);
+                }
+                r.rtt_ns.write_csv(out);
+                fclose(out);
+            }
+            std::cout << "Histograms: " << histogram_prefix << "_*hz_*b.csv" << std::endl;
+        }
+
+        for (const Result& r : results)
+        {
+            if (r.received == 0)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+
+#include "AppOptions.hpp"
+#include "SharedParticipant.hpp"
+
+// Round-trip latency over DDS, for hosts without a shared clock.
+//
+// `Messenger pong` echoes every Messenger::Message it reads on "Messenger
+// Ping" back unchanged on "Messenger Pong". `Messenger ping` sends at fixed
+// rates and payload sizes, timestamps each request locally and records
+// reply - request in a LatencyHistogram; RTT/2 stands in for one-way latency.
+namespace PingPong
+{
+
+extern const char* const kRequestTopic;
+extern const char* const kEchoTopic;
+
+class Responder : public eprosima::fastdds::dds::DataReaderListener
+{
+public:
+
+    //! --qos reliable|best-effort and --depth N, the same as given to ping;
+    //! throws std::runtime_error on bad options or DDS failures
+    Responder(
+            std::shared_ptr<SharedParticipant> participant,
+            const AppOptions& options);
+
+    ~Responder();
+
+    uint64_t echoed() const
+    {
+        return echoed_.load(std::memory_order_relaxed);
+    }
+
+    void on_data_available(
+            eprosima::fastdds::dds::DataReader* reader) override;
+
+private:
+
+    std::shared_ptr<SharedParticipant> participant_;
+    eprosima::fastdds::dds::Publisher* publisher_;
+    eprosima::fastdds::dds::DataWriter* writer_;
+    eprosima::fastdds::dds::Subscriber* subscriber_;
+    eprosima::fastdds::dds::DataReader* reader_;
+    std::atomic<uint64_t> echoed_;
+};
+
+//! `Messenger ping [--rates HZ,...] [--payloads BYTES,...] [--samples N] [--warmup N]
+//! [--qos reliable|best-effort] [--depth N] [--csv PATH] [--histogram-csv PREFIX]`
+int ping_main(
+        const AppOptions& options);
+
+} // namespace PingPong
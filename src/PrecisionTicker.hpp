@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include "AsyncLogger.hpp"
+#include "LatencyHistogram.hpp"
+#include "Metrics.hpp"
+#include "ThreadAffinity.hpp"
+
+// Fixed-rate loop for 1-10 kHz ticks, where an io_context timer's wake-up
+// jitter (tens of µs) is a large part of the period.
+//
+// Each tick sleeps until `spin` before the deadline, then busy-waits the
+// rest, so the OS wake-up latency is absorbed by the spin. Optionally the
+// thread is pinned and run under SCHED_FIFO. Lateness of every tick (ns
+// past the deadline, measured before the callback) goes into a histogram.
+class PrecisionTicker {
+public:
+    struct Options {
+        std::chrono::nanoseconds period;
+        std::chrono::nanoseconds spin;  // 0 = sleep only
+        int cpu;                        // -1 = not pinned
+        int fifo_priority;              // 0 = normal scheduling
+
+        Options()
+            : period(std::chrono::milliseconds(1))
+            , spin(std::chrono::microseconds(100))
+            , cpu(-1)
+            , fifo_priority(0)
+        {}
+    };
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    Options options_;
+    std::atomic<bool> running_;
+    LatencyHistogram lateness_ns_;
+    uint64_t ticks_;
+    uint64_t missed_;  // whole periods skipped after an overrun
+    Metrics::Counter& missed_total_;
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    void setup_thread() {
+#ifdef __linux__
+        // Default timer slack (50 µs) would be added to every sleep
+        prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+        if (options_.cpu >= 0) {
+            std::string error = pin_current_thread(static_cast<unsigned>(options_.cpu));
+            if (!error.empty()) {
+                APP_LOG_WARN("PrecisionTicker") << "Pinning to CPU " << options_.cpu << " failed: " << error;
+            }
+        }
+        if (options_.fifo_priority > 0) {
+            std::string error = set_current_thread_fifo(options_.fifo_priority);
+            if (!error.empty()) {
+                APP_LOG_WARN("PrecisionTicker") << "SCHED_FIFO " << options_.fifo_priority
+                                                << " failed: " << error;
+            }
+        }
+    }
+
+public:
+    explicit PrecisionTicker(const Options& options)
+        : options_(options)
+        , running_(true)
+        , ticks_(0)
+        , missed_(0)
+        , missed_total_(Metrics::counter("messenger_precise_ticks_missed_total",
+                                         "Whole periods skipped by precise tickers after an overrun"))
+    {}
+
+    // Blocks the calling thread until stop(); returns at once if stop()
+    // came first
+    void run(const std::function<void()>& tick) {
+        setup_thread();
+
+        clock::time_point deadline = clock::now() + options_.period;
+        while (running_.load(std::memory_order_relaxed)) {
+            if (options_.spin < options_.period) {
+                std::this_thread::sleep_until(deadline - options_.spin);
+            }
+            clock::time_point now = clock::now();
+            while (now < deadline) {
+                cpu_relax();
+                now = clock::now();
+            }
+
+            lateness_ns_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - deadline).count());
+            ticks_++;
+            tick();
+
+            deadline += options_.period;
+            // Overran by whole periods: skip them rather than firing a burst
+            now = clock::now();
+            if (now > deadline + options_.period) {
+                uint64_t behind = static_cast<uint64_t>((now - deadline) / options_.period);
+                missed_ += behind;
+                missed_total_.inc(behind);
+                deadline += options_.period * static_cast<clock::rep>(behind);
+            }
+        }
+    }
+
+    void stop() {
+        running_.store(false);
+    }
+
+    // Read after run() has returned
+    const LatencyHistogram& lateness_ns() const { return lateness_ns_; }
+    uint64_t ticks() const { return ticks_; }
+    uint64_t missed() const { return missed_; }
+};
@@ -2,32 +2,37 @@
 #include <memory>
 #include <string>
 #include <mutex>
+#include "Metrics.hpp"
+#include "Tracer.hpp"
 
 struct CoordinateData {
     double longitude;
     double latitude;
     int64_t timestamp;
     uint32_t sequence;
+    uint32_t entity_id;
     
     CoordinateData() 
         : longitude(0.0)
         , latitude(0.0)
         , timestamp(0)
         , sequence(0)
+        , entity_id(1)
     {}
     
-    CoordinateData(double lon, double lat, int64_t ts, uint32_t seq)
+    CoordinateData(double lon, double lat, int64_t ts, uint32_t seq, uint32_t entity = 1)
         : longitude(lon)
         , latitude(lat)
         , timestamp(ts)
         , sequence(seq)
+        , entity_id(entity)
     {}
     
     std::string to_json() const {
         char buffer[256];
         snprintf(buffer, sizeof(buffer), 
-                 "{\"coords\":[%.8f,%.8f],\"time\":%lld,\"seq\":%u}",
-                 longitude, latitude, (long long)timestamp, sequence);
+                 "{\"id\":%u,\"coords\":[%.8f,%.8f],\"time\":%lld,\"seq\":%u}",
+                 entity_id, longitude, latitude, (long long)timestamp, sequence);
         return std::string(buffer);
     }
     
@@ -45,21 +50,37 @@ class SharedCoordinateState {
 private:
     mutable std::mutex mutex_;
     std::shared_ptr<const CoordinateData> latest_;
+    Metrics::Counter& updates_total_;
+    Metrics::Counter& reads_total_;
+    Metrics::Gauge& sequence_;
     
 public:
-    SharedCoordinateState() {
+    SharedCoordinateState()
+        : updates_total_(Metrics::counter("messenger_shared_state_updates_total",
+                                          "Coordinates written to the shared state"))
+        , reads_total_(Metrics::counter("messenger_shared_state_reads_total",
+                                        "Reads of the latest coordinate from the shared state"))
+        , sequence_(Metrics::gauge("messenger_shared_state_sequence",
+                                   "Sequence number of the latest coordinate in the shared state"))
+    {
         latest_ = std::make_shared<CoordinateData>();
     }
     
     // Producer: update với tọa độ mới
     void update(double lon, double lat, int64_t timestamp, uint32_t sequence) {
+        TRACE_SPAN_SEQ("state_update", sequence);
         auto new_data = std::make_shared<CoordinateData>(lon, lat, timestamp, sequence);
-        std::lock_guard<std::mutex> lock(mutex_);
-        latest_ = new_data;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_ = new_data;
+        }
+        updates_total_.inc();
+        sequence_.set(sequence);
     }
     
     // Consumer: đọc tọa độ mới nhất (thread-safe)
     std::shared_ptr<const CoordinateData> get_latest() const {
+        reads_total_.inc();
         std::lock_guard<std::mutex> lock(mutex_);
         return latest_;
     }
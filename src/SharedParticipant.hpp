@@ -0,0 +1,81 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <fastdds/LibrarySettings.hpp>
+#include <fastdds/dds/domain/DomainParticipant.hpp>
+#include <fastdds/dds/domain/DomainParticipantFactory.hpp>
+#include <fastdds/dds/domain/qos/DomainParticipantQos.hpp>
+#include <fastdds/dds/topic/Topic.hpp>
+#include <fastdds/dds/topic/TypeSupport.hpp>
+
+// A DomainParticipant that several apps of one process create their
+// endpoints on. Each app deletes its own publisher/subscriber and endpoints;
+// the topics and the participant itself go with the last reference.
+//
+// Endpoints of one process match locally and, with intra-process delivery
+// on (the Fast DDS default, see set_intraprocess()), samples are handed from
+// the writer's history to the reader without going through a transport.
+class SharedParticipant {
+private:
+    std::shared_ptr<eprosima::fastdds::dds::DomainParticipantFactory> factory_;
+    eprosima::fastdds::dds::DomainParticipant* participant_;
+    std::mutex mutex_;
+
+public:
+    SharedParticipant(int domain_id, const std::string& name,
+                      const eprosima::fastdds::dds::DomainParticipantQos& base =
+                          eprosima::fastdds::dds::PARTICIPANT_QOS_DEFAULT)
+        : factory_(eprosima::fastdds::dds::DomainParticipantFactory::get_shared_instance())
+        , participant_(nullptr)
+    {
+        eprosima::fastdds::dds::DomainParticipantQos pqos = base;
+        pqos.name(name);
+        participant_ = factory_->create_participant(domain_id, pqos, nullptr,
+                                                    eprosima::fastdds::dds::StatusMask::none());
+        if (participant_ == nullptr) {
+            throw std::runtime_error("Messenger::Message Participant initialization failed");
+        }
+    }
+
+    ~SharedParticipant() {
+        participant_->delete_contained_entities();
+        factory_->delete_participant(participant_);
+    }
+
+    SharedParticipant(const SharedParticipant&) = delete;
+    SharedParticipant& operator=(const SharedParticipant&) = delete;
+
+    eprosima::fastdds::dds::DomainParticipant* get() const {
+        return participant_;
+    }
+
+    // Registers the type and returns the topic, created by the first caller
+    eprosima::fastdds::dds::Topic* topic(const std::string& topic_name,
+                                         eprosima::fastdds::dds::TypeSupport& type) {
+        using namespace eprosima::fastdds::dds;
+        std::lock_guard<std::mutex> lock(mutex_);
+        type.register_type(participant_);  // OK again for the same type
+        Topic* topic = dynamic_cast<Topic*>(participant_->lookup_topicdescription(topic_name));
+        if (topic == nullptr) {
+            TopicQos topic_qos = TOPIC_QOS_DEFAULT;
+            participant_->get_default_topic_qos(topic_qos);
+            topic = participant_->create_topic(topic_name, type.get_type_name(), topic_qos);
+        }
+        if (topic == nullptr) {
+            throw std::runtime_error("Messenger::Message Topic initialization failed");
+        }
+        return topic;
+    }
+
+    // Applies to participants created afterwards; fails while any exists
+    static bool set_intraprocess(bool enabled) {
+        eprosima::fastdds::LibrarySettings settings;
+        settings.intraprocess_delivery = enabled ? eprosima::fastdds::INTRAPROCESS_FULL
+                                                 : eprosima::fastdds::INTRAPROCESS_OFF;
+        return eprosima::fastdds::dds::DomainParticipantFactory::get_instance()->set_library_settings(settings) ==
+               eprosima::fastdds::dds::RETCODE_OK;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Time source of the pipeline: the real clocks, or virtual time (--simulate).
+//
+// In virtual mode time only moves when the TimingWheel driving the pipeline
+// jumps it to its next deadline, instead of sleeping until then, so hours of
+// 20/50/100 ms traffic run as fast as the callbacks execute. Wall-clock
+// timestamps (CoordinateGenerator::get_timestamp) start at a fixed epoch and
+// are the same on every run. One wheel on one thread must own the clock;
+// a second wheel advancing it concurrently would break the ordering.
+class SimClock {
+public:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    static bool is_virtual() {
+        return state().virtual_time.load(std::memory_order_acquire);
+    }
+
+    // Switch to virtual time at `wall_start_ms`; call before anything is scheduled
+    static void enable_virtual(int64_t wall_start_ms) {
+        State& s = state();
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        s.steady_origin_ns = now;
+        s.wall_origin_ms = wall_start_ms;
+        s.steady_ns.store(now, std::memory_order_relaxed);
+        s.virtual_time.store(true, std::memory_order_release);
+    }
+
+    static time_point steady_now() {
+        if (!is_virtual()) {
+            return std::chrono::steady_clock::now();
+        }
+        return time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(state().steady_ns.load(std::memory_order_acquire))));
+    }
+
+    // Milliseconds since the Unix epoch
+    static int64_t wall_ms() {
+        if (!is_virtual()) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        const State& s = state();
+        return s.wall_origin_ms + (s.steady_ns.load(std::memory_order_acquire) - s.steady_origin_ns) / 1000000;
+    }
+
+    // Virtual time elapsed since enable_virtual()
+    static std::chrono::nanoseconds elapsed() {
+        const State& s = state();
+        return std::chrono::nanoseconds(s.steady_ns.load(std::memory_order_acquire) - s.steady_origin_ns);
+    }
+
+    // Virtual mode: move time forward to `t`; never backwards
+    static void advance_to(time_point t) {
+        State& s = state();
+        int64_t target = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        int64_t current = s.steady_ns.load(std::memory_order_relaxed);
+        while (current < target &&
+               !s.steady_ns.compare_exchange_weak(current, target, std::memory_order_acq_rel)) {
+        }
+    }
+
+private:
+    struct State {
+        std::atomic<bool> virtual_time;
+        std::atomic<int64_t> steady_ns;
+        int64_t steady_origin_ns;
+        int64_t wall_origin_ms;
+
+        State()
+            : virtual_time(false)
+            , steady_ns(0)
+            , steady_origin_ns(0)
+            , wall_origin_ms(0)
+        {}
+    };
+
+    static State& state() {
+        static State instance;
+        return instance;
+    }
+};
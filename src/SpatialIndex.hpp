@@ -0,0 +1,282 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "GeoGrid.hpp"
+#include "SharedCoordinateState.hpp"
+
+// Latest position of every entity in a uniform grid, for "who is near X".
+//
+// update() moves an entity between cells only when it crosses a boundary,
+// so keeping the index current costs a couple of hash lookups per sample.
+// Queries visit only the cells that can contain an answer:
+//   within_bbox    cells overlapping the box (or the occupied cells, if fewer)
+//   within_radius  cells overlapping the circle's bounding box, then haversine
+//   nearest        rings of cells around the point until the k-th hit is
+//                  closer than anything in the next ring could be
+// Distances are great-circle metres. The grid does not wrap at ±180°.
+// Entities whose newest sample is more than stale_s older than the newest
+// sample of any entity are swept out (once a minute, in sample time), so
+// departed entities stop turning up in queries. Thread-safe; queries copy
+// their results out.
+class SpatialIndex {
+public:
+    struct Hit {
+        CoordinateData data;
+        double distance_m;  // 0 for bounding-box queries
+    };
+
+    static double distance_m(double lon1, double lat1, double lon2, double lat2) {
+        const double kEarthRadiusM = 6371008.8;
+        const double kRad = 3.14159265358979323846 / 180.0;
+        double dlat = (lat2 - lat1) * kRad;
+        double dlon = (lon2 - lon1) * kRad;
+        double a = std::sin(dlat / 2) * std::sin(dlat / 2) +
+                   std::cos(lat1 * kRad) * std::cos(lat2 * kRad) * std::sin(dlon / 2) * std::sin(dlon / 2);
+        return 2.0 * kEarthRadiusM * std::asin(std::min(1.0, std::sqrt(a)));
+    }
+
+private:
+    static constexpr double kMetresPerDegree = 111320.0;
+    static constexpr double kHalfCircumferenceM = 20037508.0;
+    static const int64_t kSweepIntervalMs = 60000;
+
+    struct Entry {
+        CoordinateData data;
+        uint64_t cell;
+    };
+
+    GeoGrid grid_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, Entry> entities_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells_;
+    int64_t stale_ms_;
+    int64_t newest_ms_;      // newest timestamp of any entity
+    int64_t last_sweep_ms_;  // newest_ms_ at the last sweep
+
+    void unlink(uint32_t id, uint64_t cell) {
+        auto it = cells_.find(cell);
+        if (it == cells_.end()) {
+            return;
+        }
+        std::vector<uint32_t>& ids = it->second;
+        auto pos = std::find(ids.begin(), ids.end(), id);
+        if (pos != ids.end()) {
+            *pos = ids.back();
+            ids.pop_back();
+        }
+        if (ids.empty()) {
+            cells_.erase(it);
+        }
+    }
+
+    void sweep_locked() {
+        last_sweep_ms_ = newest_ms_;
+        int64_t cutoff = newest_ms_ - stale_ms_;
+        for (auto it = entities_.begin(); it != entities_.end();) {
+            if (it->second.data.timestamp < cutoff) {
+                unlink(it->first, it->second.cell);
+                it = entities_.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    static bool in_box(const CoordinateData& d, double min_lon, double min_lat, double max_lon, double max_lat) {
+        return d.longitude >= min_lon && d.longitude <= max_lon && d.latitude >= min_lat && d.latitude <= max_lat;
+    }
+
+    // Calls f(entry) for every entity in a cell overlapping the box
+    template <typename F>
+    void for_each_candidate(double min_lon, double min_lat, double max_lon, double max_lat, F f) const {
+        if (grid_.cell_count(min_lon, min_lat, max_lon, max_lat) > cells_.size()) {
+            for (const auto& entry : entities_) {
+                f(entry.second);
+            }
+            return;
+        }
+        grid_.for_each_cell(min_lon, min_lat, max_lon, max_lat, [this, &f](uint64_t cell) {
+            auto it = cells_.find(cell);
+            if (it != cells_.end()) {
+                for (uint32_t id : it->second) {
+                    f(entities_.find(id)->second);
+                }
+            }
+        });
+    }
+
+    static void sort_by_distance(std::vector<Hit>& hits) {
+        std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+            return a.distance_m < b.distance_m || (a.distance_m == b.distance_m && a.data.entity_id < b.data.entity_id);
+        });
+    }
+
+public:
+    // 0.01° is ~1.1 km: a few entities per cell for city-scale fleets
+    explicit SpatialIndex(double cell_deg = 0.01, uint32_t stale_s = 600)
+        : grid_(cell_deg)
+        , stale_ms_(static_cast<int64_t>(stale_s) * 1000)
+        , newest_ms_(0)
+        , last_sweep_ms_(0)
+    {
+    }
+
+    void update(const CoordinateData& data) {
+        uint64_t cell = grid_.cell_of(data.longitude, data.latitude);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto result = entities_.insert(std::make_pair(data.entity_id, Entry()));
+        Entry& entry = result.first->second;
+        if (result.second) {
+            cells_[cell].push_back(data.entity_id);
+        } else if (entry.cell != cell) {
+            unlink(data.entity_id, entry.cell);
+            cells_[cell].push_back(data.entity_id);
+        }
+        entry.data = data;
+        entry.cell = cell;
+
+        newest_ms_ = std::max(newest_ms_, data.timestamp);
+        if (newest_ms_ - last_sweep_ms_ >= kSweepIntervalMs) {
+            sweep_locked();
+        }
+    }
+
+    void remove(uint32_t entity_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entities_.find(entity_id);
+        if (it != entities_.end()) {
+            unlink(entity_id, it->second.cell);
+            entities_.erase(it);
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entities_.size();
+    }
+
+    // Entities inside the box, at most `limit` (0 = all), by entity id
+    std::vector<Hit> within_bbox(double min_lon, double min_lat, double max_lon, double max_lat,
+                                 size_t limit = 0) const {
+        std::vector<Hit> hits;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for_each_candidate(min_lon, min_lat, max_lon, max_lat, [&](const Entry& e) {
+                if (in_box(e.data, min_lon, min_lat, max_lon, max_lat)) {
+                    Hit hit = {e.data, 0.0};
+                    hits.push_back(hit);
+                }
+            });
+        }
+        std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+            return a.data.entity_id < b.data.entity_id;
+        });
+        if (limit > 0 && hits.size() > limit) {
+            hits.resize(limit);
+        }
+        return hits;
+    }
+
+    // Entities within radius_m of the point, nearest first, at most `limit` (0 = all)
+    // (radius capped at half the Earth's circumference)
+    std::vector<Hit> within_radius(double lon, double lat, double radius_m, size_t limit = 0) const {
+        if (radius_m > kHalfCircumferenceM) {
+            radius_m = kHalfCircumferenceM;
+        }
+        double dlat = radius_m / kMetresPerDegree;
+        double dlon = std::min(360.0, dlat / std::max(0.01, std::cos(lat * 3.14159265358979323846 / 180.0)));
+        std::vector<Hit> hits;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for_each_candidate(std::max(-180.0, lon - dlon), std::max(-90.0, lat - dlat),
+                               std::min(180.0, lon + dlon), std::min(90.0, lat + dlat),
+                [&](const Entry& e) {
+                    double d = distance_m(lon, lat, e.data.longitude, e.data.latitude);
+                    if (d <= radius_m) {
+                        Hit hit = {e.data, d};
+                        hits.push_back(hit);
+                    }
+                });
+        }
+        sort_by_distance(hits);
+        if (limit > 0 && hits.size() > limit) {
+            hits.resize(limit);
+        }
+        return hits;
+    }
+
+    // The k entities closest to the point, nearest first
+    std::vector<Hit> nearest(double lon, double lat, size_t k) const {
+        std::vector<Hit> hits;
+        if (k == 0) {
+            return hits;
+        }
+        int32_t c0 = grid_.column(lon);
+        int32_t r0 = grid_.row(lat);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t seen = 0;
+        for (int32_t ring = 0;; ++ring) {
+            // Sparse data: once a ring has more cells than are occupied, scanning everything is cheaper
+            if (static_cast<size_t>(8 * ring) > cells_.size()) {
+                hits.clear();
+                for (const auto& entry : entities_) {
+                    const CoordinateData& d = entry.second.data;
+                    Hit hit = {d, distance_m(lon, lat, d.longitude, d.latitude)};
+                    hits.push_back(hit);
+                }
+                break;
+            }
+            auto visit = [&](int32_t c, int32_t r) {
+                auto it = cells_.find(GeoGrid::key(c, r));
+                if (it == cells_.end()) {
+                    return;
+                }
+                for (uint32_t id : it->second) {
+                    const CoordinateData& d = entities_.find(id)->second.data;
+                    Hit hit = {d, distance_m(lon, lat, d.longitude, d.latitude)};
+                    hits.push_back(hit);
+                    ++seen;
+                }
+            };
+            if (ring == 0) {
+                visit(c0, r0);
+            } else {
+                for (int32_t i = -ring; i <= ring; ++i) {
+                    visit(c0 + i, r0 - ring);
+                    visit(c0 + i, r0 + ring);
+                }
+                for (int32_t i = -ring + 1; i <= ring - 1; ++i) {
+                    visit(c0 - ring, r0 + i);
+                    visit(c0 + ring, r0 + i);
+                }
+            }
+            if (seen == entities_.size()) {
+                break;
+            }
+            if (hits.size() >= k) {
+                std::nth_element(hits.begin(), hits.begin() + (k - 1), hits.end(), [](const Hit& a, const Hit& b) {
+                    return a.distance_m < b.distance_m;
+                });
+                // Nothing in ring r+1 or beyond is closer than r whole cells
+                // away. A cell is narrowest along the longitude, and narrowest
+                // of all at the ring's highest latitude.
+                double ring_lat = std::min(89.0, std::fabs(lat) + (ring + 1) * grid_.cell_deg());
+                double cell_m = grid_.cell_deg() * kMetresPerDegree *
+                                std::max(0.01, std::cos(ring_lat * 3.14159265358979323846 / 180.0));
+                if (hits[k - 1].distance_m <= ring * cell_m) {
+                    break;
+                }
+            }
+        }
+        sort_by_distance(hits);
+        if (hits.size() > k) {
+            hits.resize(k);
+        }
+        return hits;
+    }
+};
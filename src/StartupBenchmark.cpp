@@ -0,0 +1,340 @@
+#include "StartupBenchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <fastdds/dds/core/status/SubscriptionMatchedStatus.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+
+#include "DiscoveryProfile.hpp"
+#include "LatencyHistogram.hpp"
+#include "Messenger.hpp"
+#include "MessengerPubSubTypes.hpp"
+#include "SharedParticipant.hpp"
+#include "TransportProfile.hpp"
+
+using namespace eprosima::fastdds::dds;
+
+namespace {
+
+// Its own topic, so a running publisher on the domain does not answer the probe
+const char* kProbeTopic = "Messenger Startup Probe";
+
+// The probe reports its first sample on this line, in steady_clock
+// nanoseconds. steady_clock is CLOCK_MONOTONIC, which both processes share.
+const char* kFirstSampleTag = "probe-first-sample-ns ";
+
+typedef std::chrono::steady_clock clock_type;
+
+double ms_since(
+        clock_type::time_point start,
+        clock_type::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - start).count() / 1000.0;
+}
+
+class ProbeListener : public DataReaderListener
+{
+public:
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    clock_type::time_point matched;
+    clock_type::time_point first_sample;
+    bool got_match = false;
+    bool got_sample = false;
+
+    void on_subscription_matched(
+            DataReader* /*reader*/,
+            const SubscriptionMatchedStatus& info) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (info.current_count_change == 1 && !got_match)
+        {
+            matched = clock_type::now();
+            got_match = true;
+        }
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        Messenger::Message sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (!info.valid_data)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!got_sample)
+            {
+                first_sample = clock_type::now();
+                got_sample = true;
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+} // namespace
+
+int StartupBenchmark::probe(
+        const AppOptions& options,
+        clock_type::time_point started)
+{
+    int domain_id = static_cast<int>(options.get_uint("domain", 42));
+    uint32_t timeout_ms = options.get_uint("timeout-ms", 10000);
+    try
+    {
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+
+        // The benchmark side listens when the transport is TCP
+        auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_startup_probe",
+                        discovery.apply(transport.participant_qos(false)));
+        clock_type::time_point created = clock_type::now();
+
+        TypeSupport type(new Messenger::MessagePubSubType());
+        Topic* topic = participant->topic(kProbeTopic, type);
+        Subscriber* subscriber = participant->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+        DataReaderQos reader_qos = DATAREADER_QOS_DEFAULT;
+        reader_qos.reliability().kind = ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+        reader_qos.durability().kind = DurabilityQosPolicyKind::TRANSIENT_LOCAL_DURABILITY_QOS;
+        reader_qos.history().kind = HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+        reader_qos.history().depth = 1;
+
+        ProbeListener listener;
+        DataReader* reader = subscriber ?
+                subscriber->create_datareader(topic, reader_qos, &listener, StatusMask::all()) : nullptr;
+        if (reader == nullptr)
+        {
+            throw std::runtime_error("Probe DataReader initialization failed");
+        }
+
+        bool delivered;
+        clock_type::time_point matched;
+        clock_type::time_point first_sample;
+        {
+            std::unique_lock<std::mutex> lock(listener.mutex);
+            delivered = listener.cv.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                            [&listener]() { return listener.got_sample; });
+            matched = listener.matched;
+            first_sample = listener.first_sample;
+        }
+        reader->set_listener(nullptr);
+
+        if (!delivered)
+        {
+            std::cout << "probe: no sample within " << timeout_ms << " ms" << std::endl;
+            return EXIT_FAILURE;
+        }
+        char line[160];
+        snprintf(line, sizeof(line), "probe: participant %.1f ms, matched %.1f ms, first sample %.1f ms",
+                 ms_since(started, created), ms_since(started, matched), ms_since(started, first_sample));
+        std::cout << line << std::endl;
+        std::cout << kFirstSampleTag << std::chrono::duration_cast<std::chrono::nanoseconds>(
+            first_sample.time_since_epoch()).count() << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "probe: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+int StartupBenchmark::main(
+        int argc,
+        char** argv,
+        const AppOptions& options)
+{
+#ifdef _WIN32
+    (void)argc;
+    (void)argv;
+    (void)options;
+    std::cout << "bench-startup needs fork/exec and is not available on Windows" << std::endl;
+    return EXIT_FAILURE;
+#else
+    int domain_id = static_cast<int>(options.get_uint("domain", 42));
+    uint32_t runs = std::max<uint32_t>(1, options.get_uint("runs", 10));
+    try
+    {
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "   DDS STARTUP BENCHMARK" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << "Transport: " << transport.describe() << std::endl;
+        std::cout << "Discovery: " << discovery.describe() << std::endl;
+
+        // Stand-in discovery server, on the default transports
+        std::shared_ptr<SharedParticipant> server;
+        if (discovery.uses_server() && options.has("ds-local"))
+        {
+            server = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_discovery_server",
+                            discovery.server_qos(TransportProfile().participant_qos(true)));
+            std::cout << "Hosting the discovery server in this process" << std::endl;
+        }
+
+        auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_startup_writer",
+                        discovery.apply(transport.participant_qos(true)));
+        TypeSupport type(new Messenger::MessagePubSubType());
+        Topic* topic = participant->topic(kProbeTopic, type);
+        Publisher* publisher = participant->get()->create_publisher(PUBLISHER_QOS_DEFAULT);
+        DataWriterQos writer_qos = DATAWRITER_QOS_DEFAULT;
+        writer_qos.reliability().kind = ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+        writer_qos.durability().kind = DurabilityQosPolicyKind::TRANSIENT_LOCAL_DURABILITY_QOS;
+        writer_qos.history().kind = HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+        writer_qos.history().depth = 1;
+        DataWriter* writer = publisher ? publisher->create_datawriter(topic, writer_qos) : nullptr;
+        if (writer == nullptr)
+        {
+            throw std::runtime_error("Startup benchmark DataWriter initialization failed");
+        }
+
+        // Keep publishing like the real pipeline does (20 Hz)
+        std::atomic<bool> writing(true);
+        std::thread writer_thread([writer, &writing]()
+                {
+                    Messenger::Message sample;
+                    sample.from("StartupBenchmark");
+                    sample.subject("probe");
+                    int32_t count = 0;
+                    while (writing.load())
+                    {
+                        sample.count(++count);
+                        writer->write(&sample);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    }
+                });
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        // The probe gets the same options
+        std::vector<char*> child_argv;
+        child_argv.push_back(argv[0]);
+        child_argv.push_back(const_cast<char*>("startup-probe"));
+        for (int i = 2; i < argc; ++i)
+        {
+            child_argv.push_back(argv[i]);
+        }
+        child_argv.push_back(nullptr);
+
+        LatencyHistogram startup_us;
+        LatencyHistogram lifetime_us;
+        uint32_t failed = 0;
+        for (uint32_t run = 1; run <= runs; ++run)
+        {
+            // The probe's stdout comes back through a pipe, for its first-sample time
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                writing.store(false);
+                writer_thread.join();
+                throw std::runtime_error("pipe() failed");
+            }
+            clock_type::time_point start = clock_type::now();
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                close(fds[0]);
+                close(fds[1]);
+                writing.store(false);
+                writer_thread.join();
+                throw std::runtime_error("fork() failed");
+            }
+            if (pid == 0)
+            {
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[0]);
+                close(fds[1]);
+                execvp(argv[0], child_argv.data());
+                _exit(127);
+            }
+            close(fds[1]);
+
+            long long first_sample_ns = -1;
+            size_t tag_length = strlen(kFirstSampleTag);
+            FILE* probe_out = fdopen(fds[0], "r");
+            char line[512];
+            while (probe_out && fgets(line, sizeof(line), probe_out))
+            {
+                if (strncmp(line, kFirstSampleTag, tag_length) == 0)
+                {
+                    first_sample_ns = strtoll(line + tag_length, nullptr, 10);
+                }
+                else
+                {
+                    std::cout << line;
+                }
+            }
+            if (probe_out)
+            {
+                fclose(probe_out);
+            }
+            else
+            {
+                close(fds[0]);
+            }
+
+            int status = 0;
+            waitpid(pid, &status, 0);
+            double lifetime_ms = ms_since(start, clock_type::now());
+            double elapsed_ms = (first_sample_ns - std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     start.time_since_epoch()).count()) / 1e6;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && first_sample_ns > 0)
+            {
+                startup_us.record(static_cast<int64_t>(elapsed_ms * 1000.0));
+                lifetime_us.record(static_cast<int64_t>(lifetime_ms * 1000.0));
+                std::cout << "run " << run << ": " << elapsed_ms << " ms to first sample, "
+                          << lifetime_ms << " ms to exit" << std::endl;
+            }
+            else
+            {
+                failed++;
+                std::cout << "run " << run << ": probe failed" << std::endl;
+            }
+        }
+
+        writing.store(false);
+        writer_thread.join();
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "fork() to first sample: " << startup_us.summary("us") << std::endl;
+        std::cout << "fork() to probe exit:   " << lifetime_us.summary("us") << std::endl;
+        std::cout << "Failed runs: " << failed << "/" << runs << std::endl;
+        std::cout << "========================================" << std::endl;
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+
+#include "AppOptions.hpp"
+
+// Time from process start to the first delivered sample, which is what a
+// restarted pod costs the dashboard.
+//
+// `Messenger bench-startup` keeps a writer on its own topic (TRANSIENT_LOCAL,
+// so a new reader gets the latest sample as soon as it matches) and then,
+// --runs times, starts `Messenger startup-probe` as a fresh process and
+// times it from fork() to the probe's first sample, which the probe reports
+// over its stdout (teardown is timed separately, to exit). The probe creates
+// a participant and a reader, exits on the first sample and prints where its
+// time went. Both sides take the same transport and discovery options; with
+// --discovery-server and --ds-local the benchmark also hosts the server.
+namespace StartupBenchmark
+{
+
+int main(
+        int argc,
+        char** argv,
+        const AppOptions& options);
+
+//! The child side; `started` is taken at the top of main()
+int probe(
+        const AppOptions& options,
+        std::chrono::steady_clock::time_point started);
+
+} // namespace StartupBenchmark
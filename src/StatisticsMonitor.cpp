@@ -0,0 +1,381 @@
+#include "StatisticsMonitor.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include <fastdds/config.hpp>
+
+// The statistics types ship with Fast DDS only when it is built with them
+#if defined(FASTDDS_STATISTICS) && defined(__has_include)
+#if __has_include(<fastdds/statistics/types/typesPubSubTypes.hpp>)
+#define MESSENGER_HAS_STATISTICS_TYPES 1
+#endif
+#endif
+
+#ifdef MESSENGER_HAS_STATISTICS_TYPES
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+#include <fastdds/statistics/types/typesPubSubTypes.hpp>
+
+#include "DiscoveryProfile.hpp"
+#include "SharedParticipant.hpp"
+#include "TransportProfile.hpp"
+
+using namespace eprosima::fastdds::dds;
+namespace stats = eprosima::fastdds::statistics;
+
+namespace {
+
+std::string guid_text(
+        const stats::detail::GUID_s& guid)
+{
+    // Same layout as Fast DDS prints GUIDs: prefix|entity id
+    char text[64];
+    const auto& p = guid.guidPrefix().value();
+    const auto& e = guid.entityId().value();
+    snprintf(text, sizeof(text), "%02x%02x%02x%02x.%02x%02x%02x%02x.%02x%02x%02x%02x|%x.%x.%x.%x",
+             p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8], p[9], p[10], p[11],
+             e[0], e[1], e[2], e[3]);
+    return text;
+}
+
+std::string locator_text(
+        const stats::detail::Locator_s& locator)
+{
+    char text[64];
+    const auto& a = locator.address();
+    if (locator.kind() == 1)  // UDPv4
+    {
+        snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", a[12], a[13], a[14], a[15], locator.port());
+    }
+    else if (locator.kind() == 4)  // TCPv4
+    {
+        snprintf(text, sizeof(text), "tcp %u.%u.%u.%u:%u", a[12], a[13], a[14], a[15], locator.port() & 0xffff);
+    }
+    else if (locator.kind() == 16)  // shared memory
+    {
+        snprintf(text, sizeof(text), "shm:%u", locator.port());
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "kind %d:%u", locator.kind(), locator.port());
+    }
+    return text;
+}
+
+// One statistics topic, aggregated per entity (or entity pair) and interval
+class Summary : public DataReaderListener
+{
+public:
+
+    // `counter`: samples carry running totals, report the increase
+    Summary(
+            const std::string& title,
+            const std::string& unit,
+            bool counter)
+        : title_(title)
+        , unit_(unit)
+        , counter_(counter)
+    {
+    }
+
+    virtual ~Summary()
+    {
+    }
+
+    virtual TypeSupport type() const = 0;
+
+    void report(
+            std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << title_ << ":";
+        bool any = false;
+        for (auto& entry : windows_)
+        {
+            Window& w = entry.second;
+            if (w.samples == 0)
+            {
+                continue;
+            }
+            any = true;
+            char line[160];
+            if (counter_)
+            {
+                snprintf(line, sizeof(line), "total=%.0f +%.0f", w.last, w.last - w.previous);
+                w.previous = w.last;
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "n=%llu mean=%.1f max=%.1f %s",
+                         static_cast<unsigned long long>(w.samples), w.sum / w.samples, w.max, unit_.c_str());
+            }
+            out << std::endl << "  " << entry.first << "  " << line;
+            w.samples = 0;
+            w.sum = 0.0;
+            w.max = 0.0;
+        }
+        out << (any ? "" : " (nothing this interval)") << std::endl;
+    }
+
+protected:
+
+    void add(
+            const std::string& key,
+            double value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Window& w = windows_[key];
+        w.samples++;
+        w.sum += value;
+        w.max = std::max(w.max, value);
+        w.last = value;
+    }
+
+private:
+
+    struct Window
+    {
+        uint64_t samples = 0;
+        double sum = 0.0;
+        double max = 0.0;
+        double last = 0.0;
+        double previous = 0.0;  // counters: total at the previous report
+    };
+
+    std::string title_;
+    std::string unit_;
+    bool counter_;
+    std::mutex mutex_;
+    std::map<std::string, Window> windows_;
+};
+
+class HistoryLatency : public Summary
+{
+public:
+
+    HistoryLatency()
+        : Summary("History-to-history latency (writer -> reader)", "ns", false)
+    {
+    }
+
+    TypeSupport type() const override
+    {
+        return TypeSupport(new stats::WriterReaderDataPubSubType());
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        stats::WriterReaderData sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (info.valid_data)
+            {
+                add(guid_text(sample.writer_guid()) + " -> " + guid_text(sample.reader_guid()), sample.data());
+            }
+        }
+    }
+};
+
+class NetworkLatency : public Summary
+{
+public:
+
+    NetworkLatency()
+        : Summary("Network latency (locator -> locator)", "ns", false)
+    {
+    }
+
+    TypeSupport type() const override
+    {
+        return TypeSupport(new stats::Locator2LocatorDataPubSubType());
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        stats::Locator2LocatorData sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (info.valid_data)
+            {
+                add(locator_text(sample.src_locator()) + " -> " + locator_text(sample.dst_locator()),
+                    sample.data());
+            }
+        }
+    }
+};
+
+class Throughput : public Summary
+{
+public:
+
+    Throughput()
+        : Summary("Publication throughput (writer)", "B/s", false)
+    {
+    }
+
+    TypeSupport type() const override
+    {
+        return TypeSupport(new stats::EntityDataPubSubType());
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        stats::EntityData sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (info.valid_data)
+            {
+                add(guid_text(sample.guid()), sample.data());
+            }
+        }
+    }
+};
+
+class Count : public Summary
+{
+public:
+
+    explicit Count(
+            const std::string& title)
+        : Summary(title, "", true)
+    {
+    }
+
+    TypeSupport type() const override
+    {
+        return TypeSupport(new stats::EntityCountPubSubType());
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        stats::EntityCount sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (info.valid_data)
+            {
+                add(guid_text(sample.guid()), static_cast<double>(sample.count()));
+            }
+        }
+    }
+};
+
+} // namespace
+
+int StatisticsMonitor::main(
+        const AppOptions& options)
+{
+    try
+    {
+        int domain_id = static_cast<int>(options.get_uint("domain", 42));
+        uint32_t interval_s = std::max<uint32_t>(1, options.get_uint("interval-s", 5));
+        uint32_t duration_s = options.get_uint("duration", 0);
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+
+        // Wire names of the statistics topics (fastdds/statistics/topic_names.hpp)
+        std::vector<std::pair<std::string, std::shared_ptr<Summary>>> topics;
+        topics.emplace_back("_fastdds_statistics_history2history_latency", std::make_shared<HistoryLatency>());
+        topics.emplace_back("_fastdds_statistics_network_latency", std::make_shared<NetworkLatency>());
+        topics.emplace_back("_fastdds_statistics_publication_throughput", std::make_shared<Throughput>());
+        topics.emplace_back("_fastdds_statistics_resent_datas", std::make_shared<Count>("Resent DATA (writer)"));
+        topics.emplace_back("_fastdds_statistics_heartbeat_count", std::make_shared<Count>("HEARTBEATs sent (writer)"));
+        topics.emplace_back("_fastdds_statistics_acknack_count", std::make_shared<Count>("ACKNACKs sent (reader)"));
+        topics.emplace_back("_fastdds_statistics_nackfrag_count", std::make_shared<Count>("NACKFRAGs sent (reader)"));
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "   DDS STATISTICS MONITOR" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << "Domain " << domain_id << ", every " << interval_s << " s; start the pipeline with "
+                  << "--dds-statistics" << std::endl;
+
+        // Not a statistics publisher itself
+        auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_stats_monitor",
+                        discovery.apply(transport.participant_qos(false)));
+        Subscriber* subscriber = participant->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+        if (subscriber == nullptr)
+        {
+            throw std::runtime_error("Statistics subscriber initialization failed");
+        }
+        DataReaderQos reader_qos = DATAREADER_QOS_DEFAULT;
+        reader_qos.reliability().kind = ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS;
+        reader_qos.history().kind = HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+        reader_qos.history().depth = 100;
+        std::vector<DataReader*> readers;
+        for (auto& topic : topics)
+        {
+            TypeSupport type = topic.second->type();
+            DataReader* reader = subscriber->create_datareader(participant->topic(topic.first, type), reader_qos,
+                            topic.second.get());
+            if (reader == nullptr)
+            {
+                throw std::runtime_error("Cannot subscribe to " + topic.first);
+            }
+            readers.push_back(reader);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto next = start;
+        for (;;)
+        {
+            next += std::chrono::seconds(interval_s);
+            std::this_thread::sleep_until(next);
+            std::cout << "---- " << std::chrono::duration_cast<std::chrono::seconds>(next - start).count()
+                      << " s ----" << std::endl;
+            for (auto& topic : topics)
+            {
+                topic.second->report(std::cout);
+            }
+            if (duration_s > 0 && next - start >= std::chrono::seconds(duration_s))
+            {
+                break;
+            }
+        }
+
+        for (DataReader* reader : readers)
+        {
+            reader->set_listener(nullptr);
+        }
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+#else
+
+int StatisticsMonitor::main(
+        const AppOptions& /*options*/)
+{
+    std::cout << "stats-monitor needs Fast DDS built with -DFASTDDS_STATISTICS=ON "
+              << "(and its statistics type support headers)" << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif // MESSENGER_HAS_STATISTICS_TYPES
@@ -0,0 +1,23 @@
+#pragma once
+#include "AppOptions.hpp"
+
+// `Messenger stats-monitor` subscribes to the Fast DDS statistics topics
+// that participants started with --dds-statistics publish, and prints a
+// summary every --interval-s seconds (default 5) for --duration seconds
+// (default 0 = until Ctrl+C):
+//   history2history / network latency  n, mean and max per writer->reader
+//                                       pair or locator pair
+//   publication throughput             mean and max per writer
+//   resent DATA, HEARTBEAT, ACKNACK,   running total and increase over the
+//   NACKFRAG counts                    interval per entity
+// Retransmissions and heartbeats that rise together with the latency
+// percentiles point at the reliability protocol, not at the application.
+// Needs Fast DDS with -DFASTDDS_STATISTICS=ON and its statistics type
+// support headers; without them the role explains that and exits.
+namespace StatisticsMonitor
+{
+
+int main(
+        const AppOptions& options);
+
+} // namespace StatisticsMonitor
@@ -0,0 +1,64 @@
+#pragma once
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <fastdds/dds/domain/qos/DomainParticipantQos.hpp>
+
+#include "AppOptions.hpp"
+
+// Fast DDS statistics DataWriters on our participants, from the command line:
+//   --dds-statistics              the protocol-level set below
+//   --dds-statistics A,B,...      these statistics topics instead, by alias
+//                                 (e.g. HISTORY_LATENCY_TOPIC)
+// The participants then publish the "_fastdds_statistics_*" topics, which
+// `Messenger stats-monitor` (or Fast DDS Monitor) summarizes. Needs a Fast
+// DDS built with -DFASTDDS_STATISTICS=ON; other builds ignore the property.
+class StatisticsProfile {
+public:
+    static const char* default_topics() {
+        return "HISTORY_LATENCY_TOPIC;NETWORK_LATENCY_TOPIC;PUBLICATION_THROUGHPUT_TOPIC;"
+               "RESENT_DATAS_TOPIC;HEARTBEAT_COUNT_TOPIC;ACKNACK_COUNT_TOPIC;NACKFRAG_COUNT_TOPIC";
+    }
+
+private:
+    std::string topics_;  // ';'-separated aliases, empty = off
+
+public:
+    static StatisticsProfile from_options(const AppOptions& options) {
+        StatisticsProfile profile;
+        if (!options.has("dds-statistics")) {
+            return profile;
+        }
+        std::string list = options.get_string("dds-statistics");
+        if (list.empty()) {
+            profile.topics_ = default_topics();
+            return profile;
+        }
+        std::istringstream aliases(list);
+        std::string alias;
+        while (std::getline(aliases, alias, ',')) {
+            if (alias.empty() || alias.find(';') != std::string::npos) {
+                throw std::runtime_error("Invalid --dds-statistics entry: " + alias);
+            }
+            profile.topics_ += (profile.topics_.empty() ? "" : ";") + alias;
+        }
+        return profile;
+    }
+
+    bool enabled() const {
+        return !topics_.empty();
+    }
+
+    // Returns `qos` with the statistics DataWriters switched on
+    eprosima::fastdds::dds::DomainParticipantQos apply(eprosima::fastdds::dds::DomainParticipantQos qos) const {
+        if (enabled()) {
+            qos.properties().properties().emplace_back("fastdds.statistics", topics_);
+        }
+        return qos;
+    }
+
+    std::string describe() const {
+        return enabled() ? "statistics " + topics_ : "statistics off";
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "GeoGrid.hpp"
+#include "SharedCoordinateState.hpp"
+
+// What a client asked to receive. Defaults to everything, unthrottled.
+struct Subscription {
+    bool has_bbox;
+    double min_lon;
+    double min_lat;
+    double max_lon;
+    double max_lat;
+    std::set<uint32_t> entities;  // empty = all entities
+    uint32_t min_interval_ms;     // 0 = no rate limit
+
+    Subscription()
+        : has_bbox(false)
+        , min_lon(0.0)
+        , min_lat(0.0)
+        , max_lon(0.0)
+        , max_lat(0.0)
+        , min_interval_ms(0)
+    {}
+
+    bool matches(const CoordinateData& data) const {
+        if (!entities.empty() && entities.count(data.entity_id) == 0) {
+            return false;
+        }
+        if (has_bbox && (data.longitude < min_lon || data.longitude > max_lon ||
+                         data.latitude < min_lat || data.latitude > max_lat)) {
+            return false;
+        }
+        return true;
+    }
+};
+
+// Routes an update to the clients whose subscription contains it.
+// Bounding boxes are registered in every grid cell they overlap, so routing
+// costs one cell lookup plus the clients without a (small enough) box.
+//
+// Client must expose a `Subscription subscription` member, which must not
+// change while the client is registered: remove(), edit, add().
+template <typename Client>
+class SubscriptionIndex {
+private:
+    static const uint64_t kMaxCellsPerClient = 4096;
+
+    GeoGrid grid_;
+    std::unordered_map<uint64_t, std::vector<Client*>> cells_;
+    std::vector<Client*> wide_;  // no bbox, or a bbox too large to grid
+
+    bool is_gridded(const Subscription& sub) const {
+        return sub.has_bbox &&
+               grid_.cell_count(sub.min_lon, sub.min_lat, sub.max_lon, sub.max_lat) <= kMaxCellsPerClient;
+    }
+
+    static void erase_from(std::vector<Client*>& list, Client* client) {
+        auto it = std::find(list.begin(), list.end(), client);
+        if (it != list.end()) {
+            *it = list.back();
+            list.pop_back();
+        }
+    }
+
+public:
+    explicit SubscriptionIndex(double cell_deg = 0.25)
+        : grid_(cell_deg)
+    {
+    }
+
+    void add(Client* client) {
+        const Subscription& sub = client->subscription;
+        if (!is_gridded(sub)) {
+            wide_.push_back(client);
+            return;
+        }
+        grid_.for_each_cell(sub.min_lon, sub.min_lat, sub.max_lon, sub.max_lat,
+            [this, client](uint64_t cell) {
+                cells_[cell].push_back(client);
+            });
+    }
+
+    void remove(Client* client) {
+        const Subscription& sub = client->subscription;
+        if (!is_gridded(sub)) {
+            erase_from(wide_, client);
+            return;
+        }
+        grid_.for_each_cell(sub.min_lon, sub.min_lat, sub.max_lon, sub.max_lat,
+            [this, client](uint64_t cell) {
+                auto it = cells_.find(cell);
+                if (it != cells_.end()) {
+                    erase_from(it->second, client);
+                    if (it->second.empty()) {
+                        cells_.erase(it);
+                    }
+                }
+            });
+    }
+
+    template <typename F>
+    void for_each_match(const CoordinateData& data, F f) const {
+        auto it = cells_.find(grid_.cell_of(data.longitude, data.latitude));
+        if (it != cells_.end()) {
+            for (Client* client : it->second) {
+                if (client->subscription.matches(data)) {
+                    f(*client);
+                }
+            }
+        }
+        for (Client* client : wide_) {
+            if (client->subscription.matches(data)) {
+                f(*client);
+            }
+        }
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstring>
+#include <string>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Pin the calling thread to one CPU. Returns "" or an error message.
+inline std::string pin_current_thread(unsigned cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    return rc == 0 ? "" : std::strerror(rc);
+#else
+    (void)cpu;
+    return "CPU pinning is only supported on Linux";
+#endif
+}
+
+// Run the calling thread under SCHED_FIFO at the given priority (1-99).
+// Needs CAP_SYS_NICE or an rtprio limit. Returns "" or an error message.
+inline std::string set_current_thread_fifo(int priority) {
+#ifdef __linux__
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    return rc == 0 ? "" : std::strerror(rc);
+#else
+    (void)priority;
+    return "SCHED_FIFO is only supported on Linux";
+#endif
+}
@@ -0,0 +1,470 @@
+#include "ThroughputBenchmark.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <fastdds/dds/core/status/PublicationMatchedStatus.hpp>
+#include <fastdds/dds/publisher/DataWriter.hpp>
+#include <fastdds/dds/publisher/Publisher.hpp>
+#include <fastdds/dds/publisher/qos/DataWriterQos.hpp>
+#include <fastdds/dds/subscriber/DataReader.hpp>
+#include <fastdds/dds/subscriber/DataReaderListener.hpp>
+#include <fastdds/dds/subscriber/SampleInfo.hpp>
+#include <fastdds/dds/subscriber/Subscriber.hpp>
+#include <fastdds/dds/subscriber/qos/DataReaderQos.hpp>
+
+#include "DiscoveryProfile.hpp"
+#include "Messenger.hpp"
+#include "MessengerPubSubTypes.hpp"
+#include "SharedParticipant.hpp"
+#include "StatisticsProfile.hpp"
+#include "TransportProfile.hpp"
+
+using namespace eprosima::fastdds::dds;
+
+namespace {
+
+// Its own topic, so the benchmark does not flood the dashboard pipeline
+const char* kThroughputTopic = "Messenger Throughput";
+
+typedef std::chrono::steady_clock clock_type;
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_type::now().time_since_epoch()).count();
+}
+
+// User + system CPU of the whole process
+double cpu_seconds()
+{
+#ifndef _WIN32
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+#endif
+    return 0.0;
+}
+
+struct QosChoice
+{
+    std::string name;
+    bool reliable;
+    bool keep_all;
+    int32_t depth;
+};
+
+QosChoice parse_qos(
+        const AppOptions& options)
+{
+    QosChoice qos;
+    qos.name = options.get_string("qos", "reliable");
+    qos.depth = static_cast<int32_t>(std::max<uint32_t>(1, options.get_uint("depth", 1000)));
+    if (qos.name == "reliable")
+    {
+        qos.reliable = true;
+        qos.keep_all = true;
+    }
+    else if (qos.name == "keep-last")
+    {
+        qos.reliable = true;
+        qos.keep_all = false;
+    }
+    else if (qos.name == "best-effort")
+    {
+        qos.reliable = false;
+        qos.keep_all = false;
+    }
+    else
+    {
+        throw std::runtime_error("Unknown --qos: " + qos.name + " (reliable|keep-last|best-effort)");
+    }
+    return qos;
+}
+
+DataWriterQos make_writer_qos(
+        const QosChoice& choice)
+{
+    DataWriterQos qos = DATAWRITER_QOS_DEFAULT;
+    qos.reliability().kind = choice.reliable ? ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS
+                                             : ReliabilityQosPolicyKind::BEST_EFFORT_RELIABILITY_QOS;
+    qos.reliability().max_blocking_time = Duration_t(1, 0);
+    qos.history().kind = choice.keep_all ? HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS
+                                         : HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+    qos.history().depth = choice.depth;
+    // Bounded either way: a full KEEP_ALL history blocks write()
+    qos.resource_limits().max_samples = choice.depth;
+    qos.resource_limits().max_instances = 1;
+    qos.resource_limits().max_samples_per_instance = choice.depth;
+    return qos;
+}
+
+DataReaderQos make_reader_qos(
+        const QosChoice& choice)
+{
+    DataReaderQos qos = DATAREADER_QOS_DEFAULT;
+    qos.reliability().kind = choice.reliable ? ReliabilityQosPolicyKind::RELIABLE_RELIABILITY_QOS
+                                             : ReliabilityQosPolicyKind::BEST_EFFORT_RELIABILITY_QOS;
+    qos.history().kind = choice.keep_all ? HistoryQosPolicyKind::KEEP_ALL_HISTORY_QOS
+                                         : HistoryQosPolicyKind::KEEP_LAST_HISTORY_QOS;
+    qos.history().depth = choice.depth;
+    return qos;
+}
+
+// Counts what arrives; loss is the gaps in the sequence numbers seen
+class Receiver : public DataReaderListener
+{
+private:
+
+    mutable std::mutex mutex_;
+    uint64_t received_;
+    uint64_t bytes_;
+    int64_t lowest_;
+    int64_t highest_;
+    int64_t first_ns_;
+    int64_t last_ns_;
+
+public:
+
+    Receiver()
+        : received_(0)
+        , bytes_(0)
+        , lowest_(-1)
+        , highest_(-1)
+        , first_ns_(0)
+        , last_ns_(0)
+    {
+    }
+
+    void on_data_available(
+            DataReader* reader) override
+    {
+        Messenger::Message sample;
+        SampleInfo info;
+        while (RETCODE_OK == reader->take_next_sample(&sample, &info))
+        {
+            if (!info.valid_data)
+            {
+                continue;
+            }
+            int64_t seq = sample.count();
+            int64_t now = now_ns();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (received_ == 0)
+            {
+                first_ns_ = now;
+                lowest_ = seq;
+                highest_ = seq;
+            }
+            lowest_ = std::min(lowest_, seq);
+            highest_ = std::max(highest_, seq);
+            received_++;
+            bytes_ += sample.text().size();
+            last_ns_ = now;
+        }
+    }
+
+    struct Totals
+    {
+        uint64_t received;
+        uint64_t bytes;
+        uint64_t lost;
+        int64_t first_ns;
+        int64_t last_ns;
+    };
+
+    Totals totals() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Totals t;
+        t.received = received_;
+        t.bytes = bytes_;
+        uint64_t span = received_ ? static_cast<uint64_t>(highest_ - lowest_ + 1) : 0;
+        t.lost = span > received_ ? span - received_ : 0;
+        t.first_ns = first_ns_;
+        t.last_ns = last_ns_;
+        return t;
+    }
+};
+
+std::string rate_line(
+        uint64_t samples,
+        uint64_t bytes,
+        double seconds)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%.0f samples/s, %.2f MB/s",
+             seconds > 0.0 ? samples / seconds : 0.0, seconds > 0.0 ? bytes / seconds / 1e6 : 0.0);
+    return line;
+}
+
+std::string cpu_line(
+        double cpu_s,
+        uint64_t samples)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "%.2f us CPU per sample", samples ? cpu_s * 1e6 / samples : 0.0);
+    return line;
+}
+
+} // namespace
+
+int ThroughputBenchmark::publisher_main(
+        const AppOptions& options)
+{
+    try
+    {
+        int domain_id = static_cast<int>(options.get_uint("domain", 42));
+        uint32_t rate = options.get_uint("rate", 0);
+        uint32_t duration_s = std::max<uint32_t>(1, options.get_uint("duration", 10));
+        uint32_t payload = options.get_uint("payload", 64);
+        uint32_t batch = std::max<uint32_t>(1, options.get_uint("batch", 1));
+        std::string subscriber_mode = options.get_string("subscriber", "in-process");
+        bool intraprocess = options.get_string("intraprocess", "on") != "off";
+        QosChoice qos = parse_qos(options);
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+        StatisticsProfile statistics = StatisticsProfile::from_options(options);
+        if (subscriber_mode != "in-process" && subscriber_mode != "none")
+        {
+            throw std::runtime_error("Unknown --subscriber: " + subscriber_mode + " (in-process|none)");
+        }
+        bool in_process = subscriber_mode == "in-process";
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "   DDS THROUGHPUT BENCHMARK" << std::endl;
+        std::cout << "========================================" << std::endl;
+        std::cout << "Rate: " << (rate ? std::to_string(rate) + " samples/s" : std::string("max"))
+                  << ", batch " << batch << ", payload " << payload << " bytes, " << duration_s << " s" << std::endl;
+        std::cout << "QoS: " << qos.name << " (depth " << qos.depth << ")" << std::endl;
+        std::cout << "Transport: " << transport.describe() << ", discovery: " << discovery.describe() << std::endl;
+        std::cout << "Subscriber: " << (in_process ? (intraprocess ? "in-process (intra-process delivery)"
+                                                                  : "in-process (through the transport)")
+                                                   : "separate process (bench-throughput-sub)") << std::endl;
+
+        if (!SharedParticipant::set_intraprocess(intraprocess))
+        {
+            throw std::runtime_error("Cannot change intra-process delivery setting");
+        }
+
+        auto writer_side = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_throughput_pub",
+                        statistics.apply(discovery.apply(transport.participant_qos(true))));
+        TypeSupport type(new Messenger::MessagePubSubType());
+        Publisher* publisher = writer_side->get()->create_publisher(PUBLISHER_QOS_DEFAULT);
+        DataWriter* writer = publisher ?
+                publisher->create_datawriter(writer_side->topic(kThroughputTopic, type), make_writer_qos(qos)) :
+                nullptr;
+        if (writer == nullptr)
+        {
+            throw std::runtime_error("Throughput DataWriter initialization failed");
+        }
+
+        Receiver receiver;
+        std::shared_ptr<SharedParticipant> reader_side;
+        DataReader* reader = nullptr;
+        if (in_process)
+        {
+            reader_side = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_throughput_sub",
+                            statistics.apply(discovery.apply(transport.participant_qos(false))));
+            Subscriber* subscriber = reader_side->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+            reader = subscriber ?
+                    subscriber->create_datareader(reader_side->topic(kThroughputTopic, type), make_reader_qos(qos),
+                    &receiver) : nullptr;
+            if (reader == nullptr)
+            {
+                throw std::runtime_error("Throughput DataReader initialization failed");
+            }
+        }
+
+        // A separate subscriber may be started after us
+        PublicationMatchedStatus matched;
+        clock_type::time_point match_deadline = clock_type::now() + std::chrono::seconds(in_process ? 10 : 60);
+        do
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            writer->get_publication_matched_status(matched);
+        } while (matched.current_count == 0 && clock_type::now() < match_deadline);
+        if (matched.current_count == 0)
+        {
+            throw std::runtime_error("No subscriber matched on \"" + std::string(kThroughputTopic) + "\"");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        Messenger::Message sample;
+        sample.from("ThroughputBenchmark");
+        sample.subject(qos.name);
+        sample.subject_id(1);
+        sample.text(std::string(payload, 'x'));
+
+        std::chrono::nanoseconds batch_period(rate ? 1000000000LL * batch / rate : 0);
+        uint64_t sent = 0;
+        uint64_t failed = 0;
+        int32_t seq = 0;
+        double cpu_start = cpu_seconds();
+        clock_type::time_point start = clock_type::now();
+        clock_type::time_point end = start + std::chrono::seconds(duration_s);
+        clock_type::time_point next = start;
+        clock_type::time_point next_report = start + std::chrono::seconds(1);
+        uint64_t sent_at_report = 0;
+        uint64_t received_at_report = 0;
+        while (clock_type::now() < end)
+        {
+            for (uint32_t i = 0; i < batch; ++i)
+            {
+                sample.count(++seq);
+                if (RETCODE_OK == writer->write(&sample))
+                {
+                    sent++;
+                }
+                else
+                {
+                    failed++;
+                }
+            }
+            if (rate)
+            {
+                next += batch_period;
+                std::this_thread::sleep_until(next);
+            }
+            if (clock_type::now() >= next_report)
+            {
+                uint64_t received = receiver.totals().received;
+                std::cout << "  " << std::chrono::duration_cast<std::chrono::seconds>(next_report - start).count()
+                          << "s: sent " << sent - sent_at_report << "/s";
+                if (in_process)
+                {
+                    std::cout << ", received " << received - received_at_report << "/s";
+                }
+                std::cout << std::endl;
+                sent_at_report = sent;
+                received_at_report = received;
+                next_report += std::chrono::seconds(1);
+            }
+        }
+        double send_s = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start).count() / 1e6;
+
+        // Let the reader catch up with what is still in flight
+        Receiver::Totals totals = receiver.totals();
+        if (in_process)
+        {
+            clock_type::time_point drain_deadline = clock_type::now() + std::chrono::seconds(3);
+            while (totals.received < sent && clock_type::now() < drain_deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                totals = receiver.totals();
+            }
+            reader->set_listener(nullptr);
+        }
+        double cpu_s = cpu_seconds() - cpu_start;
+
+        std::cout << "========================================" << std::endl;
+        std::cout << "Sent:     " << sent << " (" << rate_line(sent, sent * payload, send_s) << "), "
+                  << failed << " writes failed" << std::endl;
+        if (in_process)
+        {
+            double receive_s = (totals.last_ns - totals.first_ns) / 1e9;
+            uint64_t lost = sent > totals.received ? sent - totals.received : 0;
+            char loss[32];
+            snprintf(loss, sizeof(loss), "%.3f%%", sent ? 100.0 * lost / sent : 0.0);
+            std::cout << "Received: " << totals.received << " (" << rate_line(totals.received, totals.bytes, receive_s)
+                      << ")" << std::endl;
+            std::cout << "Loss:     " << lost << " (" << loss << ")" << std::endl;
+            std::cout << "CPU:      " << cpu_line(cpu_s, sent) << " (publisher + subscriber)" << std::endl;
+        }
+        else
+        {
+            std::cout << "CPU:      " << cpu_line(cpu_s, sent) << " (publisher)" << std::endl;
+        }
+        std::cout << "========================================" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
+
+int ThroughputBenchmark::subscriber_main(
+        const AppOptions& options)
+{
+    try
+    {
+        int domain_id = static_cast<int>(options.get_uint("domain", 42));
+        uint32_t idle_ms = options.get_uint("idle-ms", 2000);
+        QosChoice qos = parse_qos(options);
+        TransportProfile transport = TransportProfile::from_options(options);
+        DiscoveryProfile discovery = DiscoveryProfile::from_options(options);
+        StatisticsProfile statistics = StatisticsProfile::from_options(options);
+
+        auto participant = std::make_shared<SharedParticipant>(domain_id, "Messenger::Message_throughput_sub",
+                        statistics.apply(discovery.apply(transport.participant_qos(false))));
+        TypeSupport type(new Messenger::MessagePubSubType());
+        Receiver receiver;
+        Subscriber* subscriber = participant->get()->create_subscriber(SUBSCRIBER_QOS_DEFAULT);
+        DataReader* reader = subscriber ?
+                subscriber->create_datareader(participant->topic(kThroughputTopic, type), make_reader_qos(qos),
+                &receiver) : nullptr;
+        if (reader == nullptr)
+        {
+            throw std::runtime_error("Throughput DataReader initialization failed");
+        }
+
+        std::cout << "Waiting for bench-throughput on \"" << kThroughputTopic << "\" (QoS " << qos.name
+                  << ")..." << std::endl;
+        Receiver::Totals totals = receiver.totals();
+        while (totals.received == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            totals = receiver.totals();
+        }
+
+        // Until the publisher has been quiet for idle_ms
+        double cpu_start = cpu_seconds();
+        uint64_t received_at_report = totals.received;
+        int seconds = 0;
+        while (now_ns() - totals.last_ns < static_cast<int64_t>(idle_ms) * 1000000)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            totals = receiver.totals();
+            std::cout << "  " << ++seconds << "s: received " << totals.received - received_at_report << "/s"
+                      << std::endl;
+            received_at_report = totals.received;
+        }
+        reader->set_listener(nullptr);
+        double cpu_s = cpu_seconds() - cpu_start;
+
+        double receive_s = (totals.last_ns - totals.first_ns) / 1e9;
+        uint64_t expected = totals.received + totals.lost;
+        char loss[32];
+        snprintf(loss, sizeof(loss), "%.3f%%", expected ? 100.0 * totals.lost / expected : 0.0);
+        std::cout << "========================================" << std::endl;
+        std::cout << "Received: " << totals.received << " (" << rate_line(totals.received, totals.bytes, receive_s)
+                  << ")" << std::endl;
+        std::cout << "Loss:     " << totals.lost << " (" << loss << ", from sequence gaps)" << std::endl;
+        std::cout << "CPU:      " << cpu_line(cpu_s, totals.received) << " (subscriber)" << std::endl;
+        std::cout << "========================================" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
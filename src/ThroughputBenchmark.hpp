@@ -0,0 +1,26 @@
+#pragma once
+#include "AppOptions.hpp"
+
+// Sustained DDS throughput on a dedicated topic.
+//
+// `Messenger bench-throughput` writes for --duration seconds, either as fast
+// as the writer accepts (--rate 0, the default) or at --rate samples/s, in
+// bursts of --batch samples per wake-up. The payload is `text` padded to
+// --payload bytes. --qos picks reliable (KEEP_ALL, blocking when the
+// history is full), keep-last (RELIABLE, KEEP_LAST --depth) or best-effort.
+//
+// The subscriber runs in the same process (--subscriber in-process, the
+// default; --intraprocess off forces it through the transport) or is a
+// separate `Messenger bench-throughput-sub` started with the same options
+// (--subscriber none). Both report samples/s, MB/s, loss from sequence gaps
+// and CPU time per sample from getrusage.
+namespace ThroughputBenchmark
+{
+
+int publisher_main(
+        const AppOptions& options);
+
+int subscriber_main(
+        const AppOptions& options);
+
+} // namespace ThroughputBenchmark
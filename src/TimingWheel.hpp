@@ -0,0 +1,380 @@
+#pragma once
+#define ASIO_STANDALONE
+#include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AsyncLogger.hpp"
+#include "LatencyHistogram.hpp"
+#include "Metrics.hpp"
+#include "SimClock.hpp"
+
+// Hierarchical timing wheel driving periodic and one-shot tasks from a
+// single steady_timer on an io_context.
+//
+// Level 0 has 256 slots of one tick each; levels 1-3 have 64 slots, each
+// covering a whole turn of the level below, and are cascaded down as time
+// reaches them. Scheduling and cancelling are O(1), so thousands of
+// independent rates (e.g. one per entity) cost no more than one timer.
+//
+// Periodic tasks keep absolute deadlines (no drift); a task more than two
+// periods late is re-based instead of firing a burst. Every task records
+// how late it ran (µs past its deadline) in a LatencyHistogram.
+//
+// Thread-safe; callbacks run on the io_context without the lock held.
+// Under SimClock virtual time the wheel does not sleep: it moves the clock
+// to its next deadline and runs the due tasks right away.
+class TimingWheel {
+public:
+    typedef uint64_t TaskId;
+    typedef std::function<void()> Callback;
+
+    struct TaskStats {
+        std::string name;
+        int64_t period_us;  // 0 for one-shot
+        uint64_t runs;
+        uint64_t resets;    // deadline drift corrections
+        BasicLatencyHistogram<2> lateness_us;  // coarse: there may be thousands of tasks
+    };
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static const int kLevels = 4;
+    static const uint64_t kLevel0Bits = 8;
+    static const uint64_t kLevelBits = 6;
+    static const uint64_t kLevel0Slots = 1u << kLevel0Bits;
+    static const uint64_t kLevelSlots = 1u << kLevelBits;
+
+    struct Task {
+        Callback callback;
+        clock::time_point deadline;
+        clock::duration period;  // zero for one-shot
+        uint64_t expiry_tick;
+        TaskStats stats;
+        Metrics::Counter* resets_total;  // null for one-shot
+    };
+
+    asio::io_context& io_;
+    asio::steady_timer timer_;
+    clock::duration tick_;
+    clock::time_point epoch_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<TaskId, Task> tasks_;
+    std::vector<std::vector<TaskId>> slots_[kLevels];
+    uint64_t current_tick_;  // every tick before this one has been processed
+    TaskId next_id_;
+    bool running_;
+    bool armed_;
+    clock::time_point armed_for_;
+
+    static uint64_t level_shift(int level) {
+        return level == 0 ? 0 : kLevel0Bits + (level - 1) * kLevelBits;
+    }
+
+    // Tick whose interval contains t
+    uint64_t tick_of(clock::time_point t) const {
+        return t <= epoch_ ? 0 : static_cast<uint64_t>((t - epoch_) / tick_);
+    }
+
+    clock::time_point time_of(uint64_t tick) const {
+        return epoch_ + tick_ * static_cast<clock::rep>(tick);
+    }
+
+    // A task goes to the lowest level whose current turn contains its expiry
+    void insert(TaskId id, Task& task) {
+        uint64_t expiry = std::max(task.expiry_tick, current_tick_);
+        for (int level = 0; level < kLevels; ++level) {
+            if ((expiry >> level_shift(level + 1)) == (current_tick_ >> level_shift(level + 1))) {
+                uint64_t mask = (level == 0 ? kLevel0Slots : kLevelSlots) - 1;
+                slots_[level][(expiry >> level_shift(level)) & mask].push_back(id);
+                return;
+            }
+        }
+        // Beyond the top level's horizon: park in the next top-level slot to
+        // be cascaded, which re-inserts it (and parks it again if it is still
+        // too far out). The current slot has been cascaded already and would
+        // not come round again for a whole top-level turn.
+        uint64_t top = kLevels - 1;
+        slots_[top][((current_tick_ >> level_shift(top)) + 1) & (kLevelSlots - 1)].push_back(id);
+    }
+
+    void cascade(int level) {
+        uint64_t index = (current_tick_ >> level_shift(level)) & (kLevelSlots - 1);
+        std::vector<TaskId> moved;
+        moved.swap(slots_[level][index]);
+        for (TaskId id : moved) {
+            auto it = tasks_.find(id);
+            if (it != tasks_.end()) {
+                insert(id, it->second);
+            }
+        }
+    }
+
+    // Earliest tick at which something may be due, scanning level 0 only;
+    // otherwise wake at the next cascade boundary
+    uint64_t next_wake_tick() const {
+        for (uint64_t i = 0; i < kLevel0Slots; ++i) {
+            uint64_t tick = current_tick_ + i;
+            if (!slots_[0][tick & (kLevel0Slots - 1)].empty()) {
+                return tick;
+            }
+            if (tick != 0 && (tick & (kLevel0Slots - 1)) == 0) {
+                return tick;  // higher levels cascade when this tick is processed
+            }
+        }
+        return current_tick_ + kLevel0Slots;
+    }
+
+    // A slot spans a whole tick: wake at its earliest deadline, not at the
+    // tick boundary, so tasks are neither early nor a tick late
+    clock::time_point wake_time(uint64_t tick) const {
+        const std::vector<TaskId>& slot = slots_[0][tick & (kLevel0Slots - 1)];
+        if (slot.empty()) {
+            return time_of(tick);  // a cascade boundary: what it brings down may be due at its start
+        }
+        clock::time_point wake = time_of(tick + 1);
+        for (TaskId id : slot) {
+            auto it = tasks_.find(id);
+            if (it != tasks_.end()) {
+                wake = std::min(wake, it->second.deadline);
+            }
+        }
+        return std::max(wake, time_of(tick));
+    }
+
+    void arm_locked() {
+        if (!running_ || tasks_.empty()) {
+            armed_ = false;
+            return;
+        }
+        clock::time_point wake = wake_time(next_wake_tick());
+        if (armed_ && wake >= armed_for_) {
+            return;
+        }
+        armed_ = true;
+        armed_for_ = wake;
+        if (SimClock::is_virtual()) {
+            // Posted, so I/O handlers on the same io_context still get their turn
+            asio::post(io_, [this, wake]() {
+                SimClock::advance_to(wake);
+                on_timer(wake);
+            });
+            return;
+        }
+        timer_.expires_at(wake);
+        timer_.async_wait([this, wake](const asio::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            on_timer(wake);
+        });
+    }
+
+    void on_timer(clock::time_point fired_for) {
+        struct Due {
+            TaskId id;
+            Callback callback;
+        };
+        std::vector<Due> due;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_ || fired_for != armed_for_) {
+                return;  // stopped, or superseded by an earlier arm
+            }
+            armed_ = false;
+            clock::time_point now = SimClock::steady_now();
+            uint64_t target = tick_of(now);
+            while (current_tick_ <= target) {
+                uint64_t index = current_tick_ & (kLevel0Slots - 1);
+                if (index == 0 && current_tick_ != 0) {
+                    for (int level = 1; level < kLevels; ++level) {
+                        cascade(level);
+                        if (((current_tick_ >> level_shift(level)) & (kLevelSlots - 1)) != 0) {
+                            break;
+                        }
+                    }
+                }
+                std::vector<TaskId> slot;
+                std::vector<TaskId> not_yet;
+                slot.swap(slots_[0][index]);
+                for (TaskId id : slot) {
+                    auto it = tasks_.find(id);
+                    if (it == tasks_.end()) {
+                        continue;  // cancelled
+                    }
+                    if (it->second.expiry_tick > current_tick_) {
+                        insert(id, it->second);  // was parked beyond the horizon
+                        continue;
+                    }
+                    if (it->second.deadline > now) {
+                        not_yet.push_back(id);  // later in the tick that is running now
+                        continue;
+                    }
+                    Due d = {id, it->second.callback};
+                    due.push_back(d);
+                }
+                if (!not_yet.empty()) {
+                    slots_[0][index].swap(not_yet);
+                    break;
+                }
+                ++current_tick_;
+            }
+        }
+
+        for (auto& d : due) {
+            clock::time_point started = SimClock::steady_now();
+            d.callback();
+            reschedule(d.id, started);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        arm_locked();
+    }
+
+    void reschedule(TaskId id, clock::time_point started) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tasks_.find(id);
+        if (it == tasks_.end()) {
+            return;  // cancelled by its own callback
+        }
+        Task& task = it->second;
+        task.stats.runs++;
+        task.stats.lateness_us.record(
+            std::chrono::duration_cast<std::chrono::microseconds>(started - task.deadline).count());
+        if (task.period == clock::duration::zero()) {
+            tasks_.erase(it);
+            return;
+        }
+        task.deadline += task.period;
+        clock::time_point now = SimClock::steady_now();
+        if (task.deadline < now - task.period * 2) {
+            task.stats.resets++;
+            task.resets_total->inc();
+            APP_LOG_RATE_LIMITED(LogLevel::Warn, "TimingWheel", 1.0)
+                << "Deadline drift detected in " << task.stats.name << ", resetting";
+            task.deadline = now + task.period;
+        }
+        task.expiry_tick = tick_of(task.deadline);
+        insert(id, task);
+    }
+
+    TaskId add(const std::string& name, clock::time_point deadline, clock::duration period,
+               Callback callback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TaskId id = next_id_++;
+        Task task;
+        task.callback = callback;
+        task.deadline = deadline;
+        task.period = period;
+        task.expiry_tick = tick_of(deadline);
+        task.stats.name = name;
+        task.stats.period_us = std::chrono::duration_cast<std::chrono::microseconds>(period).count();
+        task.stats.runs = 0;
+        task.stats.resets = 0;
+        // Looked up once here, not on every drift correction
+        task.resets_total = period == clock::duration::zero() ? nullptr :
+            &Metrics::counter("messenger_deadline_resets_total",
+                              "Periodic tasks re-based after falling more than two periods behind",
+                              "task=\"" + name + "\"");
+        Task& stored = tasks_[id] = task;
+        insert(id, stored);
+        arm_locked();
+        return id;
+    }
+
+public:
+    explicit TimingWheel(asio::io_context& io,
+                         std::chrono::microseconds tick = std::chrono::milliseconds(1))
+        : io_(io)
+        , timer_(io)
+        , tick_(tick)
+        , epoch_(SimClock::steady_now())
+        , current_tick_(0)
+        , next_id_(1)
+        , running_(true)
+        , armed_(false)
+    {
+        slots_[0].resize(kLevel0Slots);
+        for (int level = 1; level < kLevels; ++level) {
+            slots_[level].resize(kLevelSlots);
+        }
+    }
+
+    asio::io_context& io() {
+        return io_;
+    }
+
+    // First run one period from now, then every period
+    TaskId schedule_periodic(const std::string& name, std::chrono::microseconds period, Callback callback) {
+        return add(name, SimClock::steady_now() + period, period, callback);
+    }
+
+    TaskId schedule_once(const std::string& name, std::chrono::microseconds delay, Callback callback) {
+        return add(name, SimClock::steady_now() + delay, clock::duration::zero(), callback);
+    }
+
+    // Safe from any thread, including from inside the task itself
+    void cancel(TaskId id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.erase(id);  // stale slot entries are skipped when reached
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tasks_.size();
+    }
+
+    // Stats of every live task (copies)
+    std::vector<TaskStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<TaskStats> out;
+        for (const auto& entry : tasks_) {
+            out.push_back(entry.second.stats);
+        }
+        return out;
+    }
+
+    bool stats_of(TaskId id, TaskStats& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = tasks_.find(id);
+        if (it == tasks_.end()) {
+            return false;
+        }
+        out = it->second.stats;
+        return true;
+    }
+
+    // e.g. "producer (period 20000 us, runs 500, resets 0): n=500 min=12 ... us late"
+    static std::string format(const TaskStats& s) {
+        char line[96];
+        snprintf(line, sizeof(line), " (period %lld us, runs %llu, resets %llu): ",
+                 static_cast<long long>(s.period_us),
+                 static_cast<unsigned long long>(s.runs), static_cast<unsigned long long>(s.resets));
+        return s.name + line + s.lateness_us.summary("us late");
+    }
+
+    // One line per live task
+    std::string report() const {
+        std::string out;
+        for (const auto& s : stats()) {
+            out += format(s) + "\n";
+        }
+        return out;
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        armed_ = false;
+        asio::post(io_, [this]() { timer_.cancel(); });
+    }
+};
@@ -0,0 +1,163 @@
+#include "Tracer.hpp"
+
+#include "AsyncLogger.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+std::atomic<bool> Tracer::active_(false);
+
+namespace {
+
+int process_id() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return static_cast<int>(getpid());
+#endif
+}
+
+// The kernel thread id where there is one, so spans line up with top/perf
+uint32_t thread_id() {
+#ifdef __linux__
+    return static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+    static std::atomic<uint32_t> next(1);
+    return next.fetch_add(1);
+#endif
+}
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer()
+    : out_(nullptr)
+    , pid_(process_id())
+    , written_(0)
+    , dropped_(0)
+    , running_(false)
+{
+}
+
+Tracer::~Tracer() {
+    stop();
+}
+
+bool Tracer::start(const std::string& path) {
+    if (running_.load()) {
+        return true;
+    }
+    out_ = fopen(path.c_str(), "w");
+    if (out_ == nullptr) {
+        return false;
+    }
+    path_ = path;
+    fprintf(out_, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+                  "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Messenger\"}}",
+            pid_);
+    running_.store(true);
+    flusher_ = std::thread(&Tracer::flush_loop, this);
+    active_.store(true, std::memory_order_relaxed);
+    APP_LOG_INFO("Tracer") << "Writing trace events to " << path;
+    return true;
+}
+
+void Tracer::stop() {
+    active_.store(false, std::memory_order_relaxed);
+    if (!running_.exchange(false)) {
+        return;
+    }
+    wake_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    fprintf(out_, "\n]}\n");
+    fclose(out_);
+    out_ = nullptr;
+    APP_LOG_INFO("Tracer") << "Wrote " << written_ << " spans to " << path_
+                           << " (" << dropped() << " dropped)";
+}
+
+Tracer::ThreadBuffer& Tracer::local_buffer() {
+    static thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        std::unique_ptr<ThreadBuffer> created(new ThreadBuffer());
+        created->tid = thread_id();
+        created->events.reset(new Event[kCapacity]);
+        created->head.store(0, std::memory_order_relaxed);
+        created->tail.store(0, std::memory_order_relaxed);
+        buffer = created.get();
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+// Single producer (the owning thread), single consumer (the flusher)
+void Tracer::record(const char* name, int64_t start_ns, int64_t end_ns, uint64_t seq) {
+    ThreadBuffer& buffer = local_buffer();
+    size_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= kCapacity) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event& event = buffer.events[head & (kCapacity - 1)];
+    event.name = name;
+    event.start_ns = start_ns;
+    event.end_ns = end_ns;
+    event.seq = seq;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+size_t Tracer::drain() {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (auto& b : buffers_) {
+            buffers.push_back(b.get());
+        }
+    }
+
+    // Complete ("X") events; ts/dur are microseconds, kept to the nanosecond
+    size_t count = 0;
+    for (ThreadBuffer* buffer : buffers) {
+        size_t tail = buffer->tail.load(std::memory_order_relaxed);
+        size_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const Event& event = buffer->events[tail & (kCapacity - 1)];
+            int64_t dur_ns = event.end_ns - event.start_ns;
+            fprintf(out_, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%lld.%03lld,"
+                          "\"dur\":%lld.%03lld,\"args\":{\"seq\":%llu}}",
+                    event.name, pid_, buffer->tid,
+                    static_cast<long long>(event.start_ns / 1000), static_cast<long long>(event.start_ns % 1000),
+                    static_cast<long long>(dur_ns / 1000), static_cast<long long>(dur_ns % 1000),
+                    static_cast<unsigned long long>(event.seq));
+            ++count;
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+    if (count > 0) {
+        fflush(out_);
+    }
+    written_ += count;
+    return count;
+}
+
+void Tracer::flush_loop() {
+    while (running_.load()) {
+        drain();
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_for(lock, std::chrono::milliseconds(50));
+    }
+    drain();
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per-sample pipeline timelines as trace-event JSON, for chrome://tracing
+// or ui.perfetto.dev.
+//
+// Spans are compiled in only with -DMESSENGER_ENABLE_TRACING=ON (which
+// defines MESSENGER_TRACING); otherwise the TRACE_* macros are empty. Even
+// when compiled in they cost one relaxed load until start() (--trace PATH).
+// Each thread appends complete spans to its own single-producer ring and a
+// background thread drains all rings into the file every 50 ms; a full ring
+// drops the span and counts it. Spans carry the coordinate sequence number
+// as args.seq, so one sample can be followed across threads.
+//
+//   TRACE_SPAN_SEQ("dds_write", data.sequence);
+class Tracer {
+public:
+    static const size_t kCapacity = 16384;  // spans per thread, power of two
+
+    static Tracer& instance();
+
+    static bool active() {
+        return active_.load(std::memory_order_relaxed);
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Opens `path` and starts recording; false if it cannot be written
+    bool start(const std::string& path);
+
+    // Drains what is left and closes the file; safe to call more than once
+    void stop();
+
+    // `name` must outlive the tracer (a string literal)
+    void record(const char* name, int64_t start_ns, int64_t end_ns, uint64_t seq);
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    ~Tracer();
+
+private:
+    struct Event {
+        const char* name;
+        int64_t start_ns;
+        int64_t end_ns;
+        uint64_t seq;
+    };
+
+    struct ThreadBuffer {
+        uint32_t tid;
+        std::unique_ptr<Event[]> events;
+        std::atomic<size_t> head;  // written by the owning thread
+        std::atomic<size_t> tail;  // written by the flusher
+    };
+
+    Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    ThreadBuffer& local_buffer();
+    void flush_loop();
+    size_t drain();
+
+    static std::atomic<bool> active_;
+
+    std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;  // never shrinks: threads may exit first
+
+    FILE* out_;  // flusher thread only, once started
+    std::string path_;
+    int pid_;
+    uint64_t written_;
+    std::atomic<uint64_t> dropped_;
+
+    std::atomic<bool> running_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::thread flusher_;
+};
+
+// Records [construction, destruction) as one span
+class TraceSpan {
+private:
+    const char* name_;
+    uint64_t seq_;
+    int64_t start_ns_;
+
+public:
+    explicit TraceSpan(const char* name, uint64_t seq = 0)
+        : name_(name)
+        , seq_(seq)
+        , start_ns_(Tracer::active() ? Tracer::now_ns() : 0)
+    {
+    }
+
+    ~TraceSpan() {
+        if (start_ns_ != 0) {
+            Tracer::instance().record(name_, start_ns_, Tracer::now_ns(), seq_);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#ifdef MESSENGER_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_SPAN_SEQ(name, seq) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name, seq)
+#else
+#define TRACE_SPAN(name) do {} while (0)
+#define TRACE_SPAN_SEQ(name, seq) do {} while (0)
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.hpp"
+#include "SharedCoordinateState.hpp"
+
+// Recent track of every entity, simplified as the samples stream in.
+//
+// Opening-window line simplification (the online form of Douglas-Peucker):
+// from the last kept point (the anchor) the window grows one sample at a
+// time; while every sample in it lies within tolerance_m of the line from
+// the anchor to the newest sample, nothing is kept. When one strays, the
+// sample before the newest becomes the next anchor. Straight stretches
+// collapse to their two ends, so a 10-minute 20 Hz trail of ~12k points
+// turns into a few dozen. The window is capped at kMaxWindow samples so each
+// add() stays cheap on long straight runs. Kept points older than the
+// retention are dropped; a sweep once a minute (in sample time) also drops
+// the trails of entities that stopped reporting. Thread-safe.
+class TrailStore {
+private:
+    static const size_t kMaxWindow = 256;
+    static const int64_t kSweepIntervalMs = 60000;
+
+    struct Trail {
+        std::deque<CoordinateData> kept;      // kept.back() is the anchor
+        std::vector<CoordinateData> window;   // samples since the anchor
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, Trail> trails_;
+    double tolerance_m_;
+    int64_t retention_ms_;
+    int64_t newest_ms_;      // newest timestamp of any entity
+    int64_t last_sweep_ms_;  // newest_ms_ at the last sweep
+    Metrics::Counter& points_in_total_;
+    Metrics::Counter& points_kept_total_;
+
+    // Distance in metres from p to the segment a-b, on a local flat projection
+    static double offset_m(const CoordinateData& p, const CoordinateData& a, const CoordinateData& b) {
+        const double kMetresPerDegree = 111320.0;
+        double kx = kMetresPerDegree * std::cos(a.latitude * 3.14159265358979323846 / 180.0);
+        double bx = (b.longitude - a.longitude) * kx;
+        double by = (b.latitude - a.latitude) * kMetresPerDegree;
+        double px = (p.longitude - a.longitude) * kx;
+        double py = (p.latitude - a.latitude) * kMetresPerDegree;
+        double len2 = bx * bx + by * by;
+        double t = len2 > 0.0 ? std::max(0.0, std::min(1.0, (px * bx + py * by) / len2)) : 0.0;
+        double dx = px - t * bx;
+        double dy = py - t * by;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    void keep(Trail& trail, const CoordinateData& point) {
+        trail.kept.push_back(point);
+        points_kept_total_.inc();
+    }
+
+    // Drops kept points before cutoff, but one, so the trail starts in the window
+    static void expire(Trail& trail, int64_t cutoff) {
+        while (trail.kept.size() > 1 && trail.kept[1].timestamp < cutoff) {
+            trail.kept.pop_front();
+        }
+    }
+
+    // Retention against the newest time seen from any entity; entities whose
+    // newest sample is older than the window are dropped altogether
+    void sweep_locked() {
+        last_sweep_ms_ = newest_ms_;
+        int64_t cutoff = newest_ms_ - retention_ms_;
+        for (auto it = trails_.begin(); it != trails_.end();) {
+            const Trail& trail = it->second;
+            int64_t last = trail.window.empty() ? trail.kept.back().timestamp : trail.window.back().timestamp;
+            if (last < cutoff) {
+                it = trails_.erase(it);
+                continue;
+            }
+            expire(it->second, cutoff);
+            ++it;
+        }
+    }
+
+public:
+    explicit TrailStore(double tolerance_m = 5.0, uint32_t retention_s = 600)
+        : tolerance_m_(tolerance_m)
+        , retention_ms_(static_cast<int64_t>(retention_s) * 1000)
+        , newest_ms_(0)
+        , last_sweep_ms_(0)
+        , points_in_total_(Metrics::counter("messenger_trail_points_in_total",
+                                            "Samples fed to trail simplification"))
+        , points_kept_total_(Metrics::counter("messenger_trail_points_kept_total",
+                                              "Samples kept as trail vertices after simplification"))
+    {
+    }
+
+    void configure(double tolerance_m, uint32_t retention_s) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tolerance_m_ = tolerance_m;
+        retention_ms_ = static_cast<int64_t>(retention_s) * 1000;
+    }
+
+    void add(const CoordinateData& data) {
+        points_in_total_.inc();
+        std::lock_guard<std::mutex> lock(mutex_);
+        Trail& trail = trails_[data.entity_id];
+        if (trail.kept.empty()) {
+            keep(trail, data);
+            return;
+        }
+        const CoordinateData& last = trail.window.empty() ? trail.kept.back() : trail.window.back();
+        if (data.timestamp <= last.timestamp) {
+            return;  // duplicate or out of order
+        }
+
+        const CoordinateData& anchor = trail.kept.back();
+        bool fits = trail.window.size() < kMaxWindow;
+        for (size_t i = 0; fits && i < trail.window.size(); ++i) {
+            fits = offset_m(trail.window[i], anchor, data) <= tolerance_m_;
+        }
+        if (!fits) {
+            keep(trail, trail.window.back());
+            trail.window.clear();
+        }
+        trail.window.push_back(data);
+
+        expire(trail, data.timestamp - retention_ms_);
+
+        // Entities that stopped reporting are only reached by the sweep
+        newest_ms_ = std::max(newest_ms_, data.timestamp);
+        if (newest_ms_ - last_sweep_ms_ >= kSweepIntervalMs) {
+            sweep_locked();
+        }
+    }
+
+    // Simplified trail of one entity since `since_ms`, oldest first, ending
+    // at its newest sample. False if the entity has no trail.
+    bool trail(uint32_t entity_id, int64_t since_ms, std::vector<CoordinateData>& out) const {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = trails_.find(entity_id);
+        if (it == trails_.end()) {
+            return false;
+        }
+        const Trail& trail = it->second;
+        for (const CoordinateData& point : trail.kept) {
+            if (point.timestamp >= since_ms) {
+                out.push_back(point);
+            }
+        }
+        if (!trail.window.empty() && trail.window.back().timestamp >= since_ms) {
+            out.push_back(trail.window.back());
+        }
+        return true;
+    }
+
+    int64_t retention_ms() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return retention_ms_;
+    }
+
+    void remove(uint32_t entity_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        trails_.erase(entity_id);
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return trails_.size();
+    }
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <fastdds/dds/domain/DomainParticipantFactory.hpp>
+#include <fastdds/dds/domain/qos/DomainParticipantQos.hpp>
+#include <fastdds/rtps/common/Locator.hpp>
+#include <fastdds/rtps/transport/TCPv4TransportDescriptor.hpp>
+#include <fastdds/rtps/transport/UDPv4TransportDescriptor.hpp>
+#include <fastdds/rtps/transport/shared_mem/SharedMemTransportDescriptor.hpp>
+#include <fastdds/utils/IPLocator.hpp>
+
+#include "AppOptions.hpp"
+
+// Which transports a participant uses, from the command line:
+//   --transport default|shm|udp|tcp
+//   --shm-segment-bytes N           shm: shared-memory segment size
+//   --udp-send-buffer N, --udp-recv-buffer N   udp: socket buffer sizes
+//   --tcp-port N                    tcp: port on 127.0.0.1 (default 5100)
+//   --dds-xml FILE [--dds-profile NAME]   start from a Fast DDS XML profile
+// Every kind but `default` replaces the builtin transports, so traffic
+// cannot fall back to another one. Over TCP one side listens and the other
+// connects to it as an initial peer.
+class TransportProfile {
+private:
+    std::string kind_;
+    uint32_t shm_segment_bytes_;  // 0 = Fast DDS default
+    uint32_t udp_send_buffer_;    // 0 = system default
+    uint32_t udp_recv_buffer_;
+    uint16_t tcp_port_;
+    std::string xml_file_;
+    std::string xml_profile_;
+
+public:
+    TransportProfile()
+        : kind_("default")
+        , shm_segment_bytes_(0)
+        , udp_send_buffer_(0)
+        , udp_recv_buffer_(0)
+        , tcp_port_(5100)
+    {}
+
+    static TransportProfile from_options(const AppOptions& options) {
+        TransportProfile profile;
+        profile.kind_ = options.get_string("transport", "default");
+        profile.shm_segment_bytes_ = options.get_uint("shm-segment-bytes", 0);
+        profile.udp_send_buffer_ = options.get_uint("udp-send-buffer", 0);
+        profile.udp_recv_buffer_ = options.get_uint("udp-recv-buffer", 0);
+        profile.tcp_port_ = static_cast<uint16_t>(options.get_uint("tcp-port", 5100));
+        profile.xml_file_ = options.get_string("dds-xml");
+        profile.xml_profile_ = options.get_string("dds-profile");
+        if (profile.kind_ != "default" && profile.kind_ != "shm" && profile.kind_ != "udp" &&
+            profile.kind_ != "tcp") {
+            throw std::runtime_error("Unknown transport: " + profile.kind_ + " (default|shm|udp|tcp)");
+        }
+        // Once per process: loading the same profiles again is an error
+        if (!profile.xml_file_.empty() &&
+            eprosima::fastdds::dds::DomainParticipantFactory::get_instance()->load_XML_profiles_file(
+                profile.xml_file_) != eprosima::fastdds::dds::RETCODE_OK) {
+            throw std::runtime_error("Cannot load DDS XML profiles from " + profile.xml_file_);
+        }
+        return profile;
+    }
+
+    // Same settings over another transport
+    TransportProfile with_kind(const std::string& kind) const {
+        TransportProfile profile = *this;
+        profile.kind_ = kind;
+        return profile;
+    }
+
+    const std::string& kind() const {
+        return kind_;
+    }
+
+    // tcp_listen: accept TCP connections on the port, otherwise connect to it
+    eprosima::fastdds::dds::DomainParticipantQos participant_qos(bool tcp_listen) const {
+        using namespace eprosima::fastdds;
+        dds::DomainParticipantQos pqos = dds::PARTICIPANT_QOS_DEFAULT;
+        if (!xml_file_.empty()) {
+            auto factory = dds::DomainParticipantFactory::get_instance();
+            pqos = factory->get_default_participant_qos();
+            if (!xml_profile_.empty() &&
+                factory->get_participant_qos_from_profile(xml_profile_, pqos) != dds::RETCODE_OK) {
+                throw std::runtime_error("No participant profile " + xml_profile_ + " in " + xml_file_);
+            }
+        }
+
+        if (kind_ == "default") {
+            return pqos;
+        }
+        if (kind_ == "shm") {
+            auto shm = std::make_shared<rtps::SharedMemTransportDescriptor>();
+            if (shm_segment_bytes_ != 0) {
+                shm->segment_size(shm_segment_bytes_);
+            }
+            pqos.transport().user_transports.push_back(shm);
+        } else if (kind_ == "udp") {
+            auto udp = std::make_shared<rtps::UDPv4TransportDescriptor>();
+            udp->interfaceWhiteList.push_back("127.0.0.1");
+            if (udp_send_buffer_ != 0) {
+                udp->sendBufferSize = udp_send_buffer_;
+            }
+            if (udp_recv_buffer_ != 0) {
+                udp->receiveBufferSize = udp_recv_buffer_;
+            }
+            pqos.transport().user_transports.push_back(udp);
+        } else if (kind_ == "tcp") {
+            auto tcp = std::make_shared<rtps::TCPv4TransportDescriptor>();
+            if (tcp_listen) {
+                tcp->add_listener_port(tcp_port_);
+            } else {
+                rtps::Locator_t peer;
+                peer.kind = LOCATOR_KIND_TCPv4;
+                rtps::IPLocator::setIPv4(peer, "127.0.0.1");
+                rtps::IPLocator::setPhysicalPort(peer, tcp_port_);
+                rtps::IPLocator::setLogicalPort(peer, 0);
+                pqos.wire_protocol().builtin.initialPeersList.push_back(peer);
+            }
+            pqos.transport().user_transports.push_back(tcp);
+        } else {
+            throw std::runtime_error("Unknown transport: " + kind_);
+        }
+        pqos.transport().use_builtin_transports = false;
+        return pqos;
+    }
+
+    // e.g. "udp (send buffer 4194304, recv buffer 4194304)"
+    std::string describe() const {
+        std::ostringstream out;
+        out << kind_;
+        if (kind_ == "shm" && shm_segment_bytes_ != 0) {
+            out << " (segment " << shm_segment_bytes_ << " bytes)";
+        } else if (kind_ == "udp" && (udp_send_buffer_ != 0 || udp_recv_buffer_ != 0)) {
+            out << " (send buffer " << udp_send_buffer_ << ", recv buffer " << udp_recv_buffer_ << ")";
+        } else if (kind_ == "tcp") {
+            out << " (127.0.0.1:" << tcp_port_ << ")";
+        }
+        if (!xml_file_.empty()) {
+            out << " from " << xml_file_;
+            if (!xml_profile_.empty()) {
+                out << ":" << xml_profile_;
+            }
+        }
+        return out.str();
+    }
+};
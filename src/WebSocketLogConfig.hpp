@@ -0,0 +1,105 @@
+#pragma once
+#define ASIO_STANDALONE
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/logger/levels.hpp>
+#include <string>
+#include "AsyncLogger.hpp"
+
+// websocketpp logger policy that forwards both the access and the error
+// channels to AsyncLogger instead of writing synchronously to std::cout.
+template <typename concurrency, typename names>
+class WebSocketLogAdapter {
+private:
+    websocketpp::log::level channels_;
+    bool error_channel_;
+
+    LogLevel severity(websocketpp::log::level channel) const {
+        if (!error_channel_) {
+            return LogLevel::Debug;
+        }
+        if (channel & (websocketpp::log::elevel::rerror | websocketpp::log::elevel::fatal)) {
+            return LogLevel::Error;
+        }
+        if (channel & websocketpp::log::elevel::warn) {
+            return LogLevel::Warn;
+        }
+        if (channel & websocketpp::log::elevel::info) {
+            return LogLevel::Info;
+        }
+        return LogLevel::Debug;
+    }
+
+public:
+    WebSocketLogAdapter(websocketpp::log::channel_type_hint::value hint =
+                            websocketpp::log::channel_type_hint::access)
+        : channels_(0)
+        , error_channel_(hint == websocketpp::log::channel_type_hint::error)
+    {
+    }
+
+    WebSocketLogAdapter(websocketpp::log::level channels,
+                        websocketpp::log::channel_type_hint::value hint =
+                            websocketpp::log::channel_type_hint::access)
+        : channels_(channels)
+        , error_channel_(hint == websocketpp::log::channel_type_hint::error)
+    {
+    }
+
+    void set_channels(websocketpp::log::level channels) {
+        channels_ |= channels;
+    }
+
+    void clear_channels(websocketpp::log::level channels) {
+        channels_ &= ~channels;
+    }
+
+    void write(websocketpp::log::level channel, const std::string& msg) {
+        write(channel, msg.c_str());
+    }
+
+    void write(websocketpp::log::level channel, const char* msg) {
+        if (!dynamic_test(channel)) {
+            return;
+        }
+        LogLevel level = severity(channel);
+        // Access logging is per frame/connection: keep it from flooding the ring
+        APP_LOG_RATE_LIMITED(level, "websocketpp", 50.0)
+            << names::channel_name(channel) << ": " << msg;
+    }
+
+    bool static_test(websocketpp::log::level channel) const {
+        return (channel & channels_) != 0;
+    }
+
+    bool dynamic_test(websocketpp::log::level channel) {
+        return (channel & channels_) != 0 && AsyncLogger::enabled(severity(channel));
+    }
+};
+
+// websocketpp::config::asio with the logger policies replaced
+struct WebSocketLogConfig : public websocketpp::config::asio {
+    typedef WebSocketLogConfig type;
+    typedef websocketpp::config::asio base;
+
+    typedef base::concurrency_type concurrency_type;
+    typedef base::request_type request_type;
+    typedef base::response_type response_type;
+    typedef base::message_type message_type;
+    typedef base::con_msg_manager_type con_msg_manager_type;
+    typedef base::endpoint_msg_manager_type endpoint_msg_manager_type;
+    typedef base::rng_type rng_type;
+
+    typedef WebSocketLogAdapter<concurrency_type, websocketpp::log::alevel> alog_type;
+    typedef WebSocketLogAdapter<concurrency_type, websocketpp::log::elevel> elog_type;
+
+    struct transport_config : public base::transport_config {
+        typedef type::concurrency_type concurrency_type;
+        typedef type::alog_type alog_type;
+        typedef type::elog_type elog_type;
+        typedef type::request_type request_type;
+        typedef type::response_type response_type;
+        typedef websocketpp::transport::asio::basic_socket::endpoint socket_type;
+    };
+
+    typedef websocketpp::transport::asio::endpoint<transport_config> transport_type;
+};
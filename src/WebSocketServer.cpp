@@ -1,145 +1,739 @@
 #include "WebSocketServer.hpp"
 #include "SharedCoordinateState.hpp"
-#include <iostream>
+#include "CoordinateCodec.hpp"
+#include "ClientCommand.hpp"
+#include "AsyncLogger.hpp"
+#include "CoordinateGenerator.hpp"
+#include "SimClock.hpp"
+#include "Tracer.hpp"
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <thread>
 
-WebSocketServer::WebSocketServer(uint32_t broadcast_rate_ms) 
+namespace {
+
+// Pacing time (virtual under --simulate); steady_now_us below stays real
+// because it measures ping RTTs and CPU time
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        SimClock::steady_now().time_since_epoch()
+    ).count();
+}
+
+int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+// How often every connection is pinged to re-estimate its link
+const int64_t kProbeIntervalMs = 1000;
+
+// Snapshots and catch-up deltas are split into frames of at most this many
+// records (the binary count field is 16-bit)
+const size_t kMaxRecordsPerFrame = 4096;
+
+} // namespace
+
+WebSocketServer::WebSocketServer(uint32_t broadcast_rate_ms, size_t thread_count) 
     : m_running(false)
+    , m_wheel(nullptr)
+    , m_broadcast_task(0)
+    , m_probe_task(0)
+    , m_client_count(0)
+    , m_thread_count(thread_count > 0 ? thread_count : 1)
+    , m_backpressure_bytes(64 * 1024)
+    , m_frames_dropped(0)
+    , m_binary_clients(0)
+    , m_adaptive_slowest_ms(1000)
     , last_broadcast_sequence_(0)
     , broadcast_rate_ms_(broadcast_rate_ms)
     , broadcasts_sent_(0)
+    , m_metric_clients(Metrics::gauge("messenger_ws_clients", "Connected WebSocket clients"))
+    , m_metric_broadcasts(Metrics::counter("messenger_ws_broadcasts_total",
+                                           "Coordinate updates broadcast to WebSocket clients"))
+    , m_metric_conflated(Metrics::counter("messenger_ws_updates_conflated_total",
+                                          "Held-back updates replaced by a newer one for the same entity"))
+    , m_metric_frames_sent(Metrics::counter("messenger_ws_frames_sent_total", "WebSocket frames queued for sending"))
+    , m_metric_bytes_sent(Metrics::counter("messenger_ws_bytes_sent_total", "WebSocket payload bytes queued for sending"))
+    , m_metric_send_errors(Metrics::counter("messenger_ws_send_errors_total", "WebSocket sends that failed"))
+    , m_metric_queued_bytes(Metrics::gauge("messenger_ws_queued_bytes",
+                                           "Bytes waiting in WebSocket send buffers, summed over clients"))
+    , m_metric_pending_updates(Metrics::gauge("messenger_ws_pending_updates",
+                                              "Conflated updates waiting for slow or rate-limited clients"))
+    , m_metric_fanout_seconds(Metrics::histogram("messenger_ws_fanout_seconds",
+                                                 "Time to hand one update to every matching client of a shard"))
+    , m_metric_broadcast_latency(Metrics::histogram("messenger_ws_broadcast_latency_seconds",
+                                                    "Coordinate generation to WebSocket fan-out, per shard (wall clock, ms resolution)",
+                                                    Metrics::Histogram::exponential(1e-3, 10.0)))
 {
+    for (size_t i = 0; i < m_thread_count; ++i) {
+        m_shards.push_back(std::unique_ptr<ConnectionShard>(new ConnectionShard()));
+    }
 }
 
-void WebSocketServer::on_open(connection_hdl hdl) {
+WebSocketServer::ConnectionShard& WebSocketServer::shard_for(connection_hdl hdl) {
+    // Pointer bits are aligned, mix them before picking a shard
+    uint64_t key = reinterpret_cast<uintptr_t>(hdl.lock().get());
+    key = (key >> 4) * 0x9E3779B97F4A7C15ull;
+    return *m_shards[(key >> 32) % m_shards.size()];
+}
+
+bool WebSocketServer::on_validate(connection_hdl hdl) {
+    // Binary format is negotiated via subprotocol; JSON stays the default
     try {
         auto con = m_server.get_con_from_hdl(hdl);
+        for (const auto& proto : con->get_requested_subprotocols()) {
+            if (proto == CoordinateCodec::binary_subprotocol()) {
+                con->select_subprotocol(proto);
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        APP_LOG_WARN("WebSocket") << "Subprotocol negotiation failed: " << e.what();
+    }
+    return true;
+}
+
+void WebSocketServer::on_open(connection_hdl hdl) {
+    connection_ptr con;
+    try {
+        con = m_server.get_con_from_hdl(hdl);
         auto& socket = con->get_socket();
 
         socket.set_option(asio::ip::tcp::no_delay(true));
     } catch (const std::exception& e) {
-        std::cerr << "[WebSocket] TCP_NODELAY failed: " << e.what() << std::endl;
+        APP_LOG_WARN("WebSocket") << "TCP_NODELAY failed: " << e.what();
+    }
+    if (!con) {
+        return;
+    }
+
+    // ...or via query parameter for clients that cannot set subprotocols
+    bool binary = con->get_subprotocol() == CoordinateCodec::binary_subprotocol() ||
+                  con->get_resource().find("format=binary") != std::string::npos;
+    if (binary) {
+        m_binary_clients++;
     }
 
-    m_connections.insert(hdl);
-    std::cout << "[WebSocket] Client connected. Total clients: "
-              << m_connections.size() << std::endl;
+    ConnectionShard& shard = shard_for(hdl);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        ClientSession& session = shard.sessions[hdl];
+        session.con = con;
+        session.binary = binary;
+        session.rate = AdaptiveRate(broadcast_rate_ms_, m_adaptive_slowest_ms);
+        shard.index.add(&session);
+        
+        // Late joiners start from the current state, not the next tick
+        send_snapshot(session, steady_now_ms());
+    }
+    m_metric_clients.inc();
+    APP_LOG_INFO("WebSocket") << "Client connected. Total clients: "
+              << ++m_client_count;
 }
 
 
 void WebSocketServer::on_close(connection_hdl hdl) {
-    m_connections.erase(hdl);
-    std::cout << "[WebSocket] Client disconnected. Total clients: " << m_connections.size() << std::endl;
+    ConnectionShard& shard = shard_for(hdl);
+    size_t erased = 0;
+    uint64_t dropped = 0;
+    double rtt_ms = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.sessions.find(hdl);
+        if (it != shard.sessions.end()) {
+            dropped = it->second.frames_dropped;
+            rtt_ms = it->second.rate.rtt_ms();
+            if (it->second.binary) {
+                m_binary_clients--;
+            }
+            shard.index.remove(&it->second);
+            shard.sessions.erase(it);
+            erased = 1;
+        }
+    }
+    if (erased) {
+        --m_client_count;
+        m_metric_clients.dec();
+    }
+    APP_LOG_INFO("WebSocket") << "Client disconnected. Total clients: " << m_client_count.load()
+              << " (client had " << dropped << " conflated updates, rtt " << rtt_ms << " ms)";
+}
+
+void WebSocketServer::on_pong(connection_hdl hdl, std::string /*payload*/) {
+    int64_t now_us = steady_now_us();
+    ConnectionShard& shard = shard_for(hdl);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(hdl);
+    if (it == shard.sessions.end()) {
+        return;
+    }
+    ClientSession& session = it->second;
+    if (session.rate.on_pong(now_us, session.bytes_sent, session.con->get_buffered_amount())) {
+        APP_LOG_RATE_LIMITED(LogLevel::Debug, "WebSocket", 10.0)
+            << "Client interval now " << session.rate.interval_ms() << " ms (rtt "
+            << session.rate.rtt_ms() << " ms, drain " << session.rate.drain_bytes_per_s() << " B/s)";
+    }
+}
+
+void WebSocketServer::on_pong_timeout(connection_hdl hdl, std::string /*payload*/) {
+    ConnectionShard& shard = shard_for(hdl);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(hdl);
+    if (it != shard.sessions.end() && it->second.rate.on_pong_timeout()) {
+        APP_LOG_RATE_LIMITED(LogLevel::Debug, "WebSocket", 10.0)
+            << "Pong timeout, client interval now " << it->second.rate.interval_ms() << " ms";
+    }
 }
 
 void WebSocketServer::on_message(connection_hdl hdl, message_ptr msg) {
-    std::string payload = msg->get_payload();
+    const std::string& payload = msg->get_payload();
     
-    std::cout << "==================================" << std::endl;
-    std::cout << "[WebSocket] Received message:" << std::endl;
-    std::cout << "Length: " << payload.length() << " bytes" << std::endl;
-    std::cout << "Content: " << payload << std::endl;
-    std::cout << "==================================" << std::endl;
+    ClientCommand cmd;
+    if (!ClientCommand::parse(payload, cmd)) {
+        reply(hdl, "", "malformed command");
+        return;
+    }
+    
+    std::string error;
+    if (cmd.verb == "SUB") {
+        error = handle_subscribe(hdl, cmd);
+    } else if (cmd.verb == "UNSUB") {
+        error = handle_unsubscribe(hdl);
+    } else if (cmd.verb == "RESYNC") {
+        error = handle_resync(hdl);
+    } else if (cmd.verb == "QUERY") {
+        error = handle_query(hdl, cmd);
+        if (error.empty()) {
+            return;  // answered with the results
+        }
+    } else if (cmd.verb == "TRAIL") {
+        error = handle_trail(hdl, cmd);
+        if (error.empty()) {
+            return;  // answered with the points
+        }
+    } else if (cmd.verb == "HISTORY") {
+        error = handle_history(hdl, cmd);
+        if (error.empty()) {
+            return;  // answered with the points
+        }
+    } else {
+        error = "unknown command";
+    }
     
+    if (!error.empty()) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 5.0) << "Rejected command \"" << payload << "\": " << error;
+    }
+    reply(hdl, cmd.verb, error);
+}
+
+// Plain HTTP on the WebSocket port for clients that just poll:
+//   GET /latest          newest state of every entity
+//   GET /entities/{id}   newest state of one entity
+// Bodies come pre-rendered from m_http_cache; If-None-Match gets a 304.
+void WebSocketServer::on_http(connection_hdl hdl) {
+    connection_ptr con;
     try {
-        m_server.send(hdl, "Server received: " + payload, msg->get_opcode());
-    } catch (const websocketpp::exception& e) {
-        std::cerr << "[WebSocket] Echo failed: " << e.what() << std::endl;
+        con = m_server.get_con_from_hdl(hdl);
+    } catch (const std::exception& e) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "HTTP", 1.0) << "Request dropped: " << e.what();
+        return;
+    }
+
+    std::string path = con->get_resource();
+    path = path.substr(0, path.find('?'));
+    con->append_header("Content-Type", "application/json");
+    con->append_header("Cache-Control", "no-cache");
+    con->append_header("Access-Control-Allow-Origin", "*");
+
+    if (con->get_request().get_method() != "GET") {
+        con->append_header("Allow", "GET");
+        con->set_status(websocketpp::http::status_code::method_not_allowed);
+        con->set_body("{\"error\":\"method not allowed\"}");
+        return;
+    }
+
+    LatestValueCache::rendered_ptr rendered;
+    const std::string entity_prefix = "/entities/";
+    if (path == "/latest") {
+        rendered = m_http_cache.latest();
+    } else if (path.compare(0, entity_prefix.size(), entity_prefix) == 0) {
+        std::string id = path.substr(entity_prefix.size());
+        char* end = nullptr;
+        unsigned long entity_id = id.empty() ? 0 : std::strtoul(id.c_str(), &end, 10);
+        if (id.empty() || *end != '\0') {
+            con->set_status(websocketpp::http::status_code::bad_request);
+            con->set_body("{\"error\":\"entity id must be a number\"}");
+            return;
+        }
+        rendered = m_http_cache.entity(static_cast<uint32_t>(entity_id));
     }
+
+    if (!rendered) {
+        con->set_status(websocketpp::http::status_code::not_found);
+        con->set_body("{\"error\":\"not found\"}");
+        return;
+    }
+
+    con->append_header("ETag", rendered->etag);
+    if (con->get_request_header("If-None-Match") == rendered->etag) {
+        con->set_status(websocketpp::http::status_code::not_modified);
+        return;
+    }
+    con->set_status(websocketpp::http::status_code::ok);
+    con->set_body(rendered->body);
 }
 
-void WebSocketServer::run(uint16_t port) {
-    m_running = true;
+// SUB [bbox=minLon,minLat,maxLon,maxLat] [ids=1,2,...] [rate=Hz]
+std::string WebSocketServer::handle_subscribe(connection_hdl hdl, const ClientCommand& cmd) {
+    Subscription sub;
+    
+    if (cmd.has("bbox")) {
+        std::vector<double> box;
+        if (!cmd.get_doubles("bbox", box) || box.size() != 4 ||
+            box[0] > box[2] || box[1] > box[3] ||
+            box[0] < -180.0 || box[2] > 180.0 || box[1] < -90.0 || box[3] > 90.0) {
+            return "bbox must be minLon,minLat,maxLon,maxLat";
+        }
+        sub.has_bbox = true;
+        sub.min_lon = box[0];
+        sub.min_lat = box[1];
+        sub.max_lon = box[2];
+        sub.max_lat = box[3];
+    }
+    
+    if (cmd.has("ids")) {
+        std::vector<uint32_t> ids;
+        if (!cmd.get_uints("ids", ids)) {
+            return "ids must be a list of entity ids";
+        }
+        sub.entities.insert(ids.begin(), ids.end());
+    }
+    
+    if (cmd.has("rate")) {
+        double rate_hz = 0.0;
+        if (!cmd.get_double("rate", rate_hz) || rate_hz <= 0.0) {
+            return "rate must be a positive number of updates per second";
+        }
+        // One update a day at the slowest, one per ms at the fastest
+        rate_hz = std::max(1.0 / 86400.0, std::min(1000.0, rate_hz));
+        sub.min_interval_ms = static_cast<uint32_t>(1000.0 / rate_hz);
+    }
+    
+    ConnectionShard& shard = shard_for(hdl);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(hdl);
+    if (it == shard.sessions.end()) {
+        return "connection not open";
+    }
+    shard.index.remove(&it->second);
+    it->second.subscription = sub;
+    shard.index.add(&it->second);
+    send_snapshot(it->second, steady_now_ms());
+    return "";
+}
 
-    try {
-        // 1. init asio
-        m_server.init_asio();
+std::string WebSocketServer::handle_unsubscribe(connection_hdl hdl) {
+    ConnectionShard& shard = shard_for(hdl);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(hdl);
+    if (it == shard.sessions.end()) {
+        return "connection not open";
+    }
+    shard.index.remove(&it->second);
+    it->second.subscription = Subscription();
+    shard.index.add(&it->second);
+    send_snapshot(it->second, steady_now_ms());
+    return "";
+}
 
-        // 3. handlers
-        m_server.set_open_handler(
-            std::bind(&WebSocketServer::on_open, this, std::placeholders::_1));
-        m_server.set_close_handler(
-            std::bind(&WebSocketServer::on_close, this, std::placeholders::_1));
-        m_server.set_message_handler(
-            std::bind(&WebSocketServer::on_message, this,
-                      std::placeholders::_1, std::placeholders::_2));
-
-        // 4. logging
-        m_server.set_error_channels(websocketpp::log::elevel::all);
-        m_server.set_access_channels(
-            websocketpp::log::alevel::all ^
-            websocketpp::log::alevel::frame_payload);
-
-        // 5. listen
-        m_server.listen(port);
-        m_server.start_accept();
-
-        std::cout << "[WebSocket] Server listening on port " << port << std::endl;
-
-        // ===============================
-        // Deadline-based broadcast (DDS-style)
-        // ===============================
-        auto& io = m_server.get_io_service();
-        auto period = std::chrono::milliseconds(broadcast_rate_ms_);
-
-        auto timer = std::make_shared<asio::steady_timer>(io);
-        auto next_deadline = std::chrono::steady_clock::now() + period;
-
-        std::function<void()> schedule;
-        schedule = [this, timer, period, &next_deadline, &schedule]() {
-            timer->expires_at(next_deadline);
-            timer->async_wait([this, timer, period, &next_deadline, &schedule]
-                              (const websocketpp::lib::error_code& ec) {
-                if (ec || !m_running) {
-                    return;
-                }
+// Client saw a sequence gap: start over from a snapshot
+std::string WebSocketServer::handle_resync(connection_hdl hdl) {
+    ConnectionShard& shard = shard_for(hdl);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sessions.find(hdl);
+    if (it == shard.sessions.end()) {
+        return "connection not open";
+    }
+    send_snapshot(it->second, steady_now_ms());
+    return "";
+}
 
-                // ---- broadcast logic ----
-                if (shared_state_ && shared_state_->has_data() &&
-                    !m_connections.empty()) {
-
-                    auto coord_data = shared_state_->get_latest();
-                    if (coord_data->sequence > last_broadcast_sequence_) {
-                        broadcast(coord_data->to_json());
-                        last_broadcast_sequence_ = coord_data->sequence;
-                        broadcasts_sent_++;
-
-                        if (broadcasts_sent_ % 50 == 0) {
-                            std::cout << "[WebSocket] Broadcasted "
-                                      << broadcasts_sent_
-                                      << " updates. Latest seq: "
-                                      << coord_data->sequence << std::endl;
-                        }
-                    }
-                }
+// Optional id=token of a QUERY, TRAIL or HISTORY, echoed in the answer
+std::string WebSocketServer::request_id(const ClientCommand& cmd, std::string& id) {
+    id.clear();
+    if (cmd.has("id")) {
+        id = cmd.args.find("id")->second;
+        for (char ch : id) {
+            if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '-' && ch != '_') {
+                return "id must be letters, digits, '-' or '_'";
+            }
+        }
+    }
+    return "";
+}
 
-                // ---- schedule next tick ----
-                next_deadline += period;
+// One-shot spatial query against the subscriber's index:
+//   QUERY near=lon,lat radius=M [limit=N]     within M metres, nearest first
+//   QUERY near=lon,lat k=N                    the N nearest entities
+//   QUERY bbox=minLon,minLat,maxLon,maxLat [limit=N]
+// An optional id=token is echoed so clients can pipeline queries. Answered with
+// {"type":"query","id":..,"ok":true,"results":[record + "distance_m", ...]}.
+std::string WebSocketServer::handle_query(connection_hdl hdl, const ClientCommand& cmd) {
+    std::shared_ptr<SpatialIndex> index = m_spatial_index;
+    if (!index) {
+        return "queries need a subscriber";
+    }
 
-                auto now = std::chrono::steady_clock::now();
-                if (next_deadline < now - period * 2) {
-                    std::cerr << "[WebSocket] WARNING: Deadline drift detected, resetting"
-                              << std::endl;
-                    next_deadline = now + period;
-                }
+    std::string id;
+    std::string error = request_id(cmd, id);
+    if (!error.empty()) {
+        return error;
+    }
 
-                schedule();
-            });
-        };
+    std::vector<uint32_t> limit(1, 0);
+    if (cmd.has("limit") && (!cmd.get_uints("limit", limit) || limit.size() != 1)) {
+        return "limit must be a number";
+    }
 
-        schedule();
+    std::vector<SpatialIndex::Hit> hits;
+    bool with_distance = true;
+    if (cmd.has("bbox")) {
+        std::vector<double> box;
+        if (!cmd.get_doubles("bbox", box) || box.size() != 4 ||
+            box[0] > box[2] || box[1] > box[3] ||
+            box[0] < -180.0 || box[2] > 180.0 || box[1] < -90.0 || box[3] > 90.0) {
+            return "bbox must be minLon,minLat,maxLon,maxLat";
+        }
+        hits = index->within_bbox(box[0], box[1], box[2], box[3], limit[0]);
+        with_distance = false;
+    } else if (cmd.has("near")) {
+        std::vector<double> point;
+        if (!cmd.get_doubles("near", point) || point.size() != 2 ||
+            point[0] < -180.0 || point[0] > 180.0 || point[1] < -90.0 || point[1] > 90.0) {
+            return "near must be lon,lat";
+        }
+        if (cmd.has("radius")) {
+            double radius_m = 0.0;
+            if (!cmd.get_double("radius", radius_m) || radius_m <= 0.0) {
+                return "radius must be a positive number of metres";
+            }
+            radius_m = std::min(radius_m, 20037508.0);  // half the Earth's circumference
+            hits = index->within_radius(point[0], point[1], radius_m, limit[0]);
+        } else if (cmd.has("k")) {
+            std::vector<uint32_t> k;
+            if (!cmd.get_uints("k", k) || k.size() != 1 || k[0] == 0) {
+                return "k must be a positive number";
+            }
+            hits = index->nearest(point[0], point[1], k[0]);
+        } else {
+            return "near needs radius=M or k=N";
+        }
+    } else {
+        return "query needs near=lon,lat or bbox=minLon,minLat,maxLon,maxLat";
+    }
+
+    std::string message = "{\"type\":\"query\",\"id\":\"" + id + "\",\"ok\":true,\"results\":[";
+    char distance[48];
+    for (size_t i = 0; i < hits.size(); ++i) {
+        std::string record = hits[i].data.to_json();
+        if (with_distance) {
+            snprintf(distance, sizeof(distance), ",\"distance_m\":%.1f}", hits[i].distance_m);
+            record.replace(record.size() - 1, 1, distance);
+        }
+        message += (i == 0 ? "" : ",") + record;
+    }
+    message += "]}";
+
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Query reply failed: " << ec.message();
+    }
+    return "";
+}
+
+// Simplified recent track of one entity (see TrailStore):
+//   TRAIL entity=N [minutes=M] [id=token]
+// Answered with {"type":"trail","id":..,"entity":N,"ok":true,"points":[[lon,lat,time],...]},
+// oldest first; live updates then continue the trail.
+std::string WebSocketServer::handle_trail(connection_hdl hdl, const ClientCommand& cmd) {
+    std::shared_ptr<TrailStore> trails = m_trail_store;
+    if (!trails) {
+        return "trails need a subscriber";
+    }
+
+    std::string id;
+    std::string error = request_id(cmd, id);
+    if (!error.empty()) {
+        return error;
+    }
+
+    std::vector<uint32_t> entity;
+    if (!cmd.get_uints("entity", entity) || entity.size() != 1) {
+        return "trail needs entity=N";
+    }
+    int64_t since_ms = 0;
+    if (cmd.has("minutes")) {
+        double minutes = 0.0;
+        if (!cmd.get_double("minutes", minutes) || minutes <= 0.0) {
+            return "minutes must be a positive number";
+        }
+        // Finite (ClientCommand) and at most the retention, so the cast is defined
+        minutes = std::min(minutes, trails->retention_ms() / 60000.0);
+        since_ms = CoordinateGenerator::get_timestamp() - static_cast<int64_t>(minutes * 60000.0);
+    }
+
+    std::vector<CoordinateData> points;
+    if (!trails->trail(entity[0], since_ms, points)) {
+        return "no trail for that entity";
+    }
+
+    std::string message = "{\"type\":\"trail\",\"id\":\"" + id + "\",\"entity\":" +
+                          std::to_string(entity[0]) + ",\"ok\":true,\"points\":[";
+    char buffer[96];
+    message.reserve(message.size() + points.size() * 48);
+    for (size_t i = 0; i < points.size(); ++i) {
+        snprintf(buffer, sizeof(buffer), "%s[%.8f,%.8f,%lld]", i == 0 ? "" : ",",
+                 points[i].longitude, points[i].latitude, (long long)points[i].timestamp);
+        message += buffer;
+    }
+    message += "]}";
+
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Trail reply failed: " << ec.message();
+    }
+    return "";
+}
+
+// Raw history of one entity from the compressed store (see HistoryStore), for replay:
+//   HISTORY entity=N [from=ms] [to=ms] [minutes=M] [limit=N] [id=token]
+// Answered with {"type":"history",..,"points":[[lon,lat,time,seq],...],"more":bool},
+// oldest first, at most `limit` points (default 10000); "more" means ask
+// again from the last time + 1 (HistoryStore keeps one point per ms).
+std::string WebSocketServer::handle_history(connection_hdl hdl, const ClientCommand& cmd) {
+    std::shared_ptr<HistoryStore> history = m_history_store;
+    if (!history) {
+        return "history needs a subscriber";
+    }
+
+    std::string id;
+    std::string error = request_id(cmd, id);
+    if (!error.empty()) {
+        return error;
+    }
+
+    std::vector<uint32_t> entity;
+    if (!cmd.get_uints("entity", entity) || entity.size() != 1) {
+        return "history needs entity=N";
+    }
+    // Bounds stay well inside int64 so the casts below are defined
+    const double kMaxMs = 9.0e18;
+    double from_ms = 0.0;
+    double to_ms = kMaxMs;
+    if (cmd.has("minutes")) {
+        double minutes = 0.0;
+        if (!cmd.get_double("minutes", minutes) || minutes <= 0.0) {
+            return "minutes must be a positive number";
+        }
+        // Nothing older than the retention is kept anyway
+        minutes = std::min(minutes, history->retention_ms() / 60000.0);
+        from_ms = CoordinateGenerator::get_timestamp() - minutes * 60000.0;
+    }
+    if ((cmd.has("from") && !cmd.get_double("from", from_ms)) ||
+        (cmd.has("to") && !cmd.get_double("to", to_ms)) ||
+        !(from_ms >= -kMaxMs && from_ms <= to_ms && to_ms <= kMaxMs)) {
+        return "from and to must be ms timestamps, from <= to";
+    }
+    std::vector<uint32_t> limit(1, 10000);
+    if (cmd.has("limit") && (!cmd.get_uints("limit", limit) || limit.size() != 1 || limit[0] == 0)) {
+        return "limit must be a positive number";
+    }
+
+    // One extra point tells whether there is more
+    std::vector<CoordinateData> points;
+    if (!history->range(entity[0], static_cast<int64_t>(from_ms), static_cast<int64_t>(to_ms), points,
+                        static_cast<size_t>(limit[0]) + 1)) {
+        return "no history for that entity";
+    }
+    bool more = points.size() > limit[0];
+    if (more) {
+        points.pop_back();
+    }
+
+    std::string message = "{\"type\":\"history\",\"id\":\"" + id + "\",\"entity\":" +
+                          std::to_string(entity[0]) + ",\"ok\":true,\"points\":[";
+    char buffer[112];
+    message.reserve(message.size() + points.size() * 56);
+    for (size_t i = 0; i < points.size(); ++i) {
+        snprintf(buffer, sizeof(buffer), "%s[%.8f,%.8f,%lld,%u]", i == 0 ? "" : ",",
+                 points[i].longitude, points[i].latitude, (long long)points[i].timestamp, points[i].sequence);
+        message += buffer;
+    }
+    message += more ? "],\"more\":true}" : "],\"more\":false}";
+
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "History reply failed: " << ec.message();
+    }
+    return "";
+}
+
+void WebSocketServer::reply(connection_hdl hdl, const std::string& cmd, const std::string& error) {
+    // The verb comes from the client: echo it only if it is a plain word
+    bool plain = cmd.size() <= 16;
+    for (char ch : cmd) {
+        plain = plain && std::isalpha(static_cast<unsigned char>(ch));
+    }
+    std::string message = "{\"type\":\"reply\",\"cmd\":\"" + (plain ? cmd : std::string()) + "\",\"ok\":" +
+                          (error.empty() ? "true" : "false");
+    if (!error.empty()) {
+        message += ",\"error\":\"" + error + "\"";
+    }
+    message += "}";
+    
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, message, websocketpp::frame::opcode::text, ec);
+    if (ec) {
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Reply failed: " << ec.message();
+    }
+}
+
+void WebSocketServer::run(uint16_t port) {
+    try {
+        // 1. init asio (own io_context and wheel)
+        m_server.init_asio();
+        m_own_wheel.reset(new TimingWheel(m_server.get_io_service()));
+        start_listening(port, *m_own_wheel);
+
+        // 6. RUN EVENT LOOP (block), optionally on a pool of io threads
+        std::vector<std::thread> io_pool;
+        for (size_t i = 1; i < m_thread_count; ++i) {
+            io_pool.emplace_back([this]() {
+                try {
+                    m_server.run();
+                } catch (const std::exception& e) {
+                    APP_LOG_WARN("WebSocket") << "io thread error: " << e.what();
+                }
+            });
+        }
+        if (m_thread_count > 1) {
+            APP_LOG_INFO("WebSocket") << "Running io_context on " << m_thread_count
+                      << " threads";
+        }
 
-        // 6. RUN EVENT LOOP (block)
         m_server.run();
 
-        std::cout << "[WebSocket] Total broadcasts sent: "
-                  << broadcasts_sent_ << std::endl;
+        for (auto& t : io_pool) {
+            t.join();
+        }
+
+        APP_LOG_INFO("WebSocket") << "Total broadcasts sent: "
+                  << broadcasts_sent_;
 
     } catch (const websocketpp::exception& e) {
-        std::cerr << "[WebSocket] Exception: " << e.what() << std::endl;
+        APP_LOG_ERROR("WebSocket") << "Exception: " << e.what();
     } catch (const std::exception& e) {
-        std::cerr << "[WebSocket] Error: " << e.what() << std::endl;
+        APP_LOG_ERROR("WebSocket") << "Error: " << e.what();
+    }
+}
+
+void WebSocketServer::start(uint16_t port, TimingWheel& wheel) {
+    // The caller owns the io_context and runs it; nothing here blocks
+    m_server.init_asio(&wheel.io());
+    start_listening(port, wheel);
+}
+
+void WebSocketServer::start_listening(uint16_t port, TimingWheel& wheel) {
+    for (auto& shard : m_shards) {
+        shard->strand.reset(new asio::strand<asio::io_context::executor_type>(
+            m_server.get_io_service().get_executor()));
+    }
+    m_running = true;
+
+    // 3. handlers
+    m_server.set_validate_handler(
+        std::bind(&WebSocketServer::on_validate, this, std::placeholders::_1));
+    m_server.set_open_handler(
+        std::bind(&WebSocketServer::on_open, this, std::placeholders::_1));
+    m_server.set_close_handler(
+        std::bind(&WebSocketServer::on_close, this, std::placeholders::_1));
+    m_server.set_message_handler(
+        std::bind(&WebSocketServer::on_message, this,
+                  std::placeholders::_1, std::placeholders::_2));
+    m_server.set_http_handler(
+        std::bind(&WebSocketServer::on_http, this, std::placeholders::_1));
+    m_server.set_pong_handler(
+        std::bind(&WebSocketServer::on_pong, this,
+                  std::placeholders::_1, std::placeholders::_2));
+    m_server.set_pong_timeout_handler(
+        std::bind(&WebSocketServer::on_pong_timeout, this,
+                  std::placeholders::_1, std::placeholders::_2));
+
+    // 4. logging (routed through AsyncLogger, see WebSocketLogConfig.hpp);
+    //    per-frame access logging is left off, it dominated the io thread
+    m_server.clear_access_channels(websocketpp::log::alevel::all);
+    m_server.set_access_channels(
+        websocketpp::log::alevel::connect |
+        websocketpp::log::alevel::disconnect |
+        websocketpp::log::alevel::fail);
+    m_server.set_error_channels(
+        websocketpp::log::elevel::info |
+        websocketpp::log::elevel::warn |
+        websocketpp::log::elevel::rerror |
+        websocketpp::log::elevel::fatal);
+
+    // 5. listen
+    m_server.listen(port);
+    m_server.start_accept();
+
+    APP_LOG_INFO("WebSocket") << "Server listening on port " << port;
+
+    // Periodic broadcast and link probes run as timing wheel tasks
+    m_wheel = &wheel;
+    m_broadcast_task = wheel.schedule_periodic("ws-broadcast", std::chrono::milliseconds(broadcast_rate_ms_),
+                                               [this]() { broadcast_tick(); });
+    if (m_adaptive_slowest_ms > 0) {
+        m_probe_task = wheel.schedule_periodic("ws-probe", std::chrono::milliseconds(kProbeIntervalMs),
+                                               [this]() { probe_clients(); });
+    }
+}
+
+void WebSocketServer::broadcast_tick() {
+    if (!m_running) {
+        return;
+    }
+
+    // ---- retry clients that were held back ----
+    flush_pending();
+
+    // ---- broadcast logic ----
+    if (shared_state_ && shared_state_->has_data() &&
+        m_client_count.load() > 0) {
+
+        auto coord_data = shared_state_->get_latest();
+        if (coord_data->sequence > last_broadcast_sequence_) {
+            broadcast_coordinates(*coord_data);
+            last_broadcast_sequence_ = coord_data->sequence;
+            broadcasts_sent_++;
+            m_metric_broadcasts.inc();
+
+            if (broadcasts_sent_ % 50 == 0) {
+                APP_LOG_INFO("WebSocket") << "Broadcasted "
+                          << broadcasts_sent_
+                          << " updates. Latest seq: "
+                          << coord_data->sequence
+                          << ", conflated updates: "
+                          << m_frames_dropped.load();
+            }
+        }
     }
 }
 
@@ -148,32 +742,301 @@ void WebSocketServer::stop() {
         return;
     }
     
-    std::cout << "[WebSocket] Stopping server..." << std::endl;
+    APP_LOG_INFO("WebSocket") << "Stopping server...";
     m_running = false;
     
+    if (m_wheel) {
+        TimingWheel::TaskStats stats;
+        if (m_wheel->stats_of(m_broadcast_task, stats)) {
+            APP_LOG_INFO("WebSocket") << "Broadcast jitter: " << TimingWheel::format(stats);
+        }
+        m_wheel->cancel(m_broadcast_task);
+        m_wheel->cancel(m_probe_task);
+    }
+    
     try {
         // Đóng tất cả connections
-        for (auto& conn : m_connections) {
-            m_server.close(conn, websocketpp::close::status::going_away, "Server shutting down");
+        for (auto& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            for (auto& entry : shard->sessions) {
+                m_server.close(entry.first, websocketpp::close::status::going_away, "Server shutting down");
+            }
         }
         
         m_server.stop_listening();
         m_server.stop();
     } catch (const std::exception& e) {
-        std::cerr << "[WebSocket] Error stopping: " << e.what() << std::endl;
+        APP_LOG_WARN("WebSocket") << "Error stopping: " << e.what();
     }
 }
 
+// Raw frames bypass subscriptions and conflation
 void WebSocketServer::broadcast(const std::string& message) {
-    for (auto& conn : m_connections) {
-        try {
-            m_server.send(conn, message, websocketpp::frame::opcode::text);
-        } catch (const websocketpp::exception& e) {
-            std::cerr << "[WebSocket] Broadcast error: " << e.what() << std::endl;
+    if (!m_running.load()) {
+        return;
+    }
+    
+    if (m_shards.size() == 1) {
+        broadcast_shard(*m_shards[0], message);
+        return;
+    }
+    
+    auto shared_message = std::make_shared<const std::string>(message);
+    for (auto& shard : m_shards) {
+        ConnectionShard* target = shard.get();
+        asio::post(*target->strand, [this, target, shared_message]() {
+            broadcast_shard(*target, *shared_message);
+        });
+    }
+}
+
+void WebSocketServer::broadcast_shard(ConnectionShard& shard, const std::string& message) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (auto& entry : shard.sessions) {
+        send_raw(entry.second, message, websocketpp::frame::opcode::text);
+    }
+}
+
+void WebSocketServer::broadcast_coordinates(const CoordinateData& data) {
+    // Unchanged positions are not resent; the table still keeps the newest
+    bool moved = m_entities.update(data);
+    m_http_cache.update(data);
+    if (!moved || !m_running.load()) {
+        return;
+    }
+    
+    // Only pay for the encodings somebody actually receives
+    size_t binary_clients = m_binary_clients.load();
+    records_ptr records = encode_records(&data, 1, CoordinateCodec::FRAME_DELTA,
+                                         m_client_count.load() > binary_clients,
+                                         binary_clients > 0);
+    
+    if (m_shards.size() == 1) {
+        broadcast_update_shard(*m_shards[0], data, records);
+        return;
+    }
+    
+    // Fan out: each shard is routed on whichever io thread picks it up,
+    // one update at a time and in order
+    for (auto& shard : m_shards) {
+        ConnectionShard* target = shard.get();
+        asio::post(*target->strand, [this, target, data, records]() {
+            broadcast_update_shard(*target, data, records);
+        });
+    }
+}
+
+void WebSocketServer::broadcast_update_shard(ConnectionShard& shard, const CoordinateData& data,
+                                             const records_ptr& records) {
+    TRACE_SPAN_SEQ("ws_send", data.sequence);
+    int64_t started_us = steady_now_us();
+    int64_t now_ms = steady_now_ms();
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.for_each_match(data, [&](ClientSession& session) {
+            deliver(session, data, records, now_ms);
+        });
+    }
+    m_metric_fanout_seconds.observe((steady_now_us() - started_us) / 1e6);
+    m_metric_broadcast_latency.observe((CoordinateGenerator::get_timestamp() - data.timestamp) / 1000.0);
+}
+
+void WebSocketServer::deliver(ClientSession& session, const CoordinateData& data,
+                              const records_ptr& records, int64_t now_ms) {
+    bool encoded = session.binary ? !records->binary.empty() : !records->json.empty();
+    if (encoded && session.pending.empty() && can_send(session, now_ms)) {
+        send_records(session, CoordinateCodec::FRAME_DELTA, *records);
+        session.last_send_ms = now_ms;
+        return;
+    }
+    
+    // Held back: keep only the newest update of this entity
+    auto result = session.pending.insert(std::make_pair(data.entity_id, data));
+    if (!result.second) {
+        result.first->second = data;
+        session.frames_dropped++;
+        m_frames_dropped++;
+        m_metric_conflated.inc();
+    }
+    if (can_send(session, now_ms)) {
+        send_pending(session, now_ms);
+    }
+}
+
+bool WebSocketServer::can_send(const ClientSession& session, int64_t now_ms) const {
+    uint32_t interval_ms = std::max(session.subscription.min_interval_ms, session.rate.interval_ms());
+    return session.con->get_buffered_amount() <= m_backpressure_bytes &&
+           now_ms - session.last_send_ms >= interval_ms;
+}
+
+WebSocketServer::records_ptr WebSocketServer::encode_records(const CoordinateData* data, size_t count,
+                                                             uint8_t frame_type, bool json, bool binary) {
+    TRACE_SPAN_SEQ("ws_encode", count > 0 ? data[count - 1].sequence : 0);
+    auto records = std::make_shared<EncodedRecords>();
+    records->sent_us = CoordinateCodec::now_us();
+    if (json) {
+        CoordinateCodec::encode_json_records(data, count, records->json);
+    }
+    if (binary) {
+        CoordinateCodec::encode_binary(data, count, frame_type, 0, records->sent_us, records->binary);
+    }
+    return records;
+}
+
+// The outgoing message is assembled from this connection's own header and
+// the shared records, so the records are copied once (into the message, as
+// any send() does) and never into a per-connection frame first
+void WebSocketServer::send_records(ClientSession& session, uint8_t frame_type, const EncodedRecords& records) {
+    uint32_t seq = ++session.frame_seq;
+    message_ptr msg;
+    if (session.binary) {
+        char header[CoordinateCodec::kHeaderSize];
+        std::memcpy(header, records.binary.data(), sizeof(header));
+        CoordinateCodec::set_frame_sequence(header, seq);
+        msg = make_message(websocketpp::frame::opcode::binary, records.binary.size());
+        msg->append_payload(header, sizeof(header));
+        msg->append_payload(records.binary.data() + sizeof(header), records.binary.size() - sizeof(header));
+    } else {
+        std::string prefix = CoordinateCodec::json_frame_prefix(frame_type, seq, records.sent_us);
+        const char* suffix = CoordinateCodec::json_frame_suffix();
+        msg = make_message(websocketpp::frame::opcode::text, prefix.size() + records.json.size() + strlen(suffix));
+        msg->append_payload(prefix);
+        msg->append_payload(records.json);
+        msg->append_payload(suffix, strlen(suffix));
+    }
+    send_message(session, msg);
+}
+
+WebSocketServer::message_ptr WebSocketServer::make_message(websocketpp::frame::opcode::value opcode, size_t size) {
+    // No connection message manager: the buffer is simply freed after sending
+    return std::make_shared<message_type>(message_type::con_msg_man_ptr(), opcode, size);
+}
+
+void WebSocketServer::send_raw(ClientSession& session, const std::string& payload,
+                               websocketpp::frame::opcode::value opcode) {
+    message_ptr msg = make_message(opcode, payload.size());
+    msg->append_payload(payload);
+    send_message(session, msg);
+}
+
+void WebSocketServer::send_message(ClientSession& session, const message_ptr& msg) {
+    size_t size = msg->get_payload().size();
+    websocketpp::lib::error_code ec = session.con->send(msg);
+    if (!ec) {
+        session.bytes_sent += size;
+        m_metric_frames_sent.inc();
+        m_metric_bytes_sent.inc(size);
+    }
+    if (ec) {
+        m_metric_send_errors.inc();
+        APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Broadcast error: " << ec.message();
+    }
+}
+
+// Catch-up delta with the newest held-back update of every entity
+void WebSocketServer::send_pending(ClientSession& session, int64_t now_ms) {
+    std::vector<CoordinateData> records;
+    records.reserve(session.pending.size());
+    for (const auto& entry : session.pending) {
+        records.push_back(entry.second);
+    }
+    session.pending.clear();
+    
+    send_chunked(session, CoordinateCodec::FRAME_DELTA, records);
+    session.last_send_ms = now_ms;
+}
+
+// Full state of every entity the client is subscribed to
+void WebSocketServer::send_snapshot(ClientSession& session, int64_t now_ms) {
+    std::vector<CoordinateData> records;
+    const Subscription& sub = session.subscription;
+    m_entities.snapshot(records, [&sub](const CoordinateData& d) { return sub.matches(d); });
+    session.pending.clear();
+    
+    send_chunked(session, CoordinateCodec::FRAME_SNAPSHOT, records);
+    session.last_send_ms = now_ms;
+}
+
+// At least one frame, even for no records (an empty snapshot still tells
+// the client it is in sync)
+void WebSocketServer::send_chunked(ClientSession& session, uint8_t frame_type,
+                                   const std::vector<CoordinateData>& records) {
+    size_t offset = 0;
+    do {
+        size_t count = std::min(kMaxRecordsPerFrame, records.size() - offset);
+        send_records(session, frame_type,
+                     *encode_records(records.data() + offset, count, frame_type,
+                                     !session.binary, session.binary));
+        offset += count;
+    } while (offset < records.size());
+}
+
+// Also samples the queue depth gauges, since it visits every session anyway
+void WebSocketServer::flush_pending() {
+    int64_t now_ms = steady_now_ms();
+    int64_t queued_bytes = 0;
+    int64_t pending_updates = 0;
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& entry : shard->sessions) {
+            ClientSession& session = entry.second;
+            if (!session.pending.empty() && can_send(session, now_ms)) {
+                send_pending(session, now_ms);
+            }
+            queued_bytes += static_cast<int64_t>(session.con->get_buffered_amount());
+            pending_updates += static_cast<int64_t>(session.pending.size());
+        }
+    }
+    m_metric_queued_bytes.set(queued_bytes);
+    m_metric_pending_updates.set(pending_updates);
+}
+
+// Ping every client without an outstanding probe; the pong (or its
+// timeout) adjusts the client's AdaptiveRate
+void WebSocketServer::probe_clients() {
+    int64_t now_us = steady_now_us();
+    for (auto& shard : m_shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto& entry : shard->sessions) {
+            ClientSession& session = entry.second;
+            if (session.rate.probe_outstanding()) {
+                continue;
+            }
+            websocketpp::lib::error_code ec;
+            session.con->ping("", ec);
+            if (ec) {
+                APP_LOG_RATE_LIMITED(LogLevel::Warn, "WebSocket", 1.0) << "Ping failed: " << ec.message();
+                continue;
+            }
+            session.rate.on_probe_sent(now_us, session.bytes_sent, session.con->get_buffered_amount());
         }
     }
 }
 
 void WebSocketServer::set_shared_state(std::shared_ptr<SharedCoordinateState> state) {
     shared_state_ = state;
-}
\ No newline at end of file
+}
+
+void WebSocketServer::set_spatial_index(std::shared_ptr<SpatialIndex> index) {
+    m_spatial_index = index;
+}
+
+void WebSocketServer::set_trail_store(std::shared_ptr<TrailStore> trails) {
+    m_trail_store = trails;
+}
+
+void WebSocketServer::set_history_store(std::shared_ptr<HistoryStore> history) {
+    m_history_store = history;
+}
+
+void WebSocketServer::set_backpressure_threshold(size_t bytes) {
+    m_backpressure_bytes = bytes;
+}
+
+uint64_t WebSocketServer::get_frames_dropped() const {
+    return m_frames_dropped.load();
+}
+
+void WebSocketServer::set_adaptive_rate(uint32_t slowest_ms) {
+    m_adaptive_slowest_ms = slowest_ms;
+}
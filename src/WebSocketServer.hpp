@@ -2,40 +2,184 @@
 #define ASIO_STANDALONE
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
+#include "WebSocketLogConfig.hpp"
 #include <cstdint>
 #include <atomic>
-#include <set>
+#include <mutex>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
+#include "AdaptiveRate.hpp"
+#include "EntityStateTable.hpp"
+#include "HistoryStore.hpp"
+#include "LatestValueCache.hpp"
+#include "Metrics.hpp"
+#include "SharedCoordinateState.hpp"
+#include "SpatialIndex.hpp"
+#include "SubscriptionIndex.hpp"
+#include "TimingWheel.hpp"
+#include "TrailStore.hpp"
 
-class SharedCoordinateState;
+struct ClientCommand;
 
 class WebSocketServer {
 private:
-    typedef websocketpp::server<websocketpp::config::asio> server_t;
+    typedef websocketpp::server<WebSocketLogConfig> server_t;
     typedef server_t::message_ptr message_ptr;
+    typedef message_ptr::element_type message_type;
+    typedef server_t::connection_ptr connection_ptr;
     typedef websocketpp::connection_hdl connection_hdl;
-    
+
+    // Records encoded once per wire format and shared by every client they
+    // are sent to; each connection only stamps its own frame sequence
+    struct EncodedRecords {
+        std::string json;    // comma-separated record objects
+        std::string binary;  // complete binary frame
+        int64_t sent_us;     // send time stamped on both encodings
+    };
+    typedef std::shared_ptr<const EncodedRecords> records_ptr;
+
+    // Per-client send state. While a client is over the backpressure
+    // threshold or its subscription rate, only the newest update per entity
+    // is kept (latest-value conflation) and sent later as one catch-up frame.
+    struct ClientSession {
+        connection_ptr con;
+        bool binary;  // negotiated CoordinateCodec binary format
+        Subscription subscription;
+        std::map<uint32_t, CoordinateData> pending;
+        int64_t last_send_ms;
+        uint64_t frames_dropped;
+        uint32_t frame_seq;  // last sequence number sent on this connection
+        uint64_t bytes_sent;
+        AdaptiveRate rate;   // throttles slow links on top of the subscription
+
+        ClientSession() : binary(false), last_send_ms(0), frames_dropped(0), frame_seq(0), bytes_sent(0) {}
+    };
+    typedef std::map<connection_hdl, ClientSession, std::owner_less<connection_hdl>> session_map;
+
+    // Connections are sharded (one shard per io thread) so handlers running
+    // on different threads only contend when they land on the same shard.
+    // Fan-out work for a shard goes through its strand, so updates reach the
+    // shard in the order they were broadcast even with several io threads.
+    struct ConnectionShard {
+        std::mutex mutex;
+        session_map sessions;
+        SubscriptionIndex<ClientSession> index;
+        std::unique_ptr<asio::strand<asio::io_context::executor_type>> strand;  // made once asio is up
+    };
+
     server_t m_server;
     std::atomic<bool> m_running;
-    std::set<connection_hdl, std::owner_less<connection_hdl>> m_connections;
-    
+    std::unique_ptr<TimingWheel> m_own_wheel;
+    TimingWheel* m_wheel;
+    TimingWheel::TaskId m_broadcast_task;
+    TimingWheel::TaskId m_probe_task;
+    std::vector<std::unique_ptr<ConnectionShard>> m_shards;
+    std::atomic<size_t> m_client_count;
+    size_t m_thread_count;
+    size_t m_backpressure_bytes;
+    std::atomic<uint64_t> m_frames_dropped;
+    std::atomic<size_t> m_binary_clients;
+    uint32_t m_adaptive_slowest_ms;  // 0 = adaptive rate disabled
+    EntityStateTable m_entities;
+    LatestValueCache m_http_cache;
+
     // Shared state for broadcasting
     std::shared_ptr<SharedCoordinateState> shared_state_;
+    std::shared_ptr<SpatialIndex> m_spatial_index;  // QUERY command
+    std::shared_ptr<TrailStore> m_trail_store;      // TRAIL command
+    std::shared_ptr<HistoryStore> m_history_store;  // HISTORY command
     uint32_t last_broadcast_sequence_;
     uint32_t broadcast_rate_ms_;
     uint32_t broadcasts_sent_;
-    
+
+    // Scraped through MetricsHttpServer
+    Metrics::Gauge& m_metric_clients;
+    Metrics::Counter& m_metric_broadcasts;
+    Metrics::Counter& m_metric_conflated;
+    Metrics::Counter& m_metric_frames_sent;
+    Metrics::Counter& m_metric_bytes_sent;
+    Metrics::Counter& m_metric_send_errors;
+    Metrics::Gauge& m_metric_queued_bytes;
+    Metrics::Gauge& m_metric_pending_updates;
+    Metrics::Histogram& m_metric_fanout_seconds;
+    Metrics::Histogram& m_metric_broadcast_latency;
+
     // Callback handlers
+    bool on_validate(connection_hdl hdl);
     void on_open(connection_hdl hdl);
     void on_close(connection_hdl hdl);
     void on_message(connection_hdl hdl, message_ptr msg);
-    
+    void on_http(connection_hdl hdl);
+    void on_pong(connection_hdl hdl, std::string payload);
+    void on_pong_timeout(connection_hdl hdl, std::string payload);
+
+    // Client commands (see ClientCommand.hpp); return "" or an error message
+    std::string handle_subscribe(connection_hdl hdl, const ClientCommand& cmd);
+    std::string handle_unsubscribe(connection_hdl hdl);
+    std::string handle_resync(connection_hdl hdl);
+    std::string handle_query(connection_hdl hdl, const ClientCommand& cmd);
+    std::string handle_trail(connection_hdl hdl, const ClientCommand& cmd);
+    std::string handle_history(connection_hdl hdl, const ClientCommand& cmd);
+    static std::string request_id(const ClientCommand& cmd, std::string& id);
+    void reply(connection_hdl hdl, const std::string& cmd, const std::string& error);
+
+    void start_listening(uint16_t port, TimingWheel& wheel);
+    void broadcast_tick();
+
+    ConnectionShard& shard_for(connection_hdl hdl);
+    void broadcast_shard(ConnectionShard& shard, const std::string& message);
+    void broadcast_update_shard(ConnectionShard& shard, const CoordinateData& data,
+                                const records_ptr& records);
+    void deliver(ClientSession& session, const CoordinateData& data,
+                 const records_ptr& records, int64_t now_ms);
+    bool can_send(const ClientSession& session, int64_t now_ms) const;
+    static records_ptr encode_records(const CoordinateData* data, size_t count,
+                                      uint8_t frame_type, bool json, bool binary);
+    void send_records(ClientSession& session, uint8_t frame_type, const EncodedRecords& records);
+    static message_ptr make_message(websocketpp::frame::opcode::value opcode, size_t size);
+    void send_raw(ClientSession& session, const std::string& payload,
+                  websocketpp::frame::opcode::value opcode);
+    void send_message(ClientSession& session, const message_ptr& msg);
+    void send_pending(ClientSession& session, int64_t now_ms);
+    void send_snapshot(ClientSession& session, int64_t now_ms);
+    void send_chunked(ClientSession& session, uint8_t frame_type, const std::vector<CoordinateData>& records);
+    void flush_pending();
+    void probe_clients();
+
 public:
-    WebSocketServer(uint32_t broadcast_rate_ms = 50); // Default ~10Hz
-    
+    // thread_count > 1 runs the io_context on a pool of threads
+    WebSocketServer(uint32_t broadcast_rate_ms = 50, size_t thread_count = 1); // Default ~10Hz
+
+    // Runs its own io_context (and pool); blocks until stop()
     void run(uint16_t port);
+    // Shares the caller's wheel and its io_context instead; returns once
+    // listening. stop() then stops that io_context as well.
+    void start(uint16_t port, TimingWheel& wheel);
     void stop();
     void broadcast(const std::string& message);
-    
+
+    // Record the update and, if the entity moved, send it as a delta to
+    // every client whose subscription contains it. Encoded once per format.
+    void broadcast_coordinates(const CoordinateData& data);
+
     void set_shared_state(std::shared_ptr<SharedCoordinateState> state);
-};
\ No newline at end of file
+
+    // Index answering the QUERY command (radius, nearest-k, bounding box)
+    void set_spatial_index(std::shared_ptr<SpatialIndex> index);
+
+    // Simplified per-entity tracks answering the TRAIL command
+    void set_trail_store(std::shared_ptr<TrailStore> trails);
+
+    // Compressed per-entity history answering the HISTORY command
+    void set_history_store(std::shared_ptr<HistoryStore> history);
+
+    // Above this many queued bytes a client only keeps its newest updates
+    void set_backpressure_threshold(size_t bytes);
+    uint64_t get_frames_dropped() const;
+
+    // Let each client's update interval grow up to slowest_ms when pings
+    // show it cannot keep up (0 disables; default 1000)
+    void set_adaptive_rate(uint32_t slowest_ms);
+};
@@ -0,0 +1,443 @@
+// ws_loadgen: opens many WebSocket clients against WebSocketServer and
+// measures fan-out latency (server send time -> client receive time),
+// missed source samples (gaps in each entity's sample sequence, so updates
+// conflated or sampled away by the server count too) and server CPU usage.
+//
+//   ws_loadgen --url ws://127.0.0.1:8081 --connections 2000 --threads 4 \
+//              --duration 30 --server-pid $(pidof Messenger)
+
+#define ASIO_STANDALONE
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <websocketpp/client.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "AppOptions.hpp"
+#include "CoordinateCodec.hpp"
+#include "LatencyHistogram.hpp"
+
+typedef websocketpp::client<websocketpp::config::asio_client> client_t;
+
+namespace {
+
+std::atomic<bool> g_stop(false);
+
+void on_signal(int) {
+    g_stop.store(true);
+}
+
+int64_t system_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// utime + stime of a process in clock ticks, -1 if unavailable
+long long process_cpu_ticks(int pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string content((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+    auto paren = content.rfind(')');
+    if (paren == std::string::npos) {
+        return -1;
+    }
+    std::istringstream fields(content.substr(paren + 2));
+    std::string field;
+    long long utime = 0;
+    long long stime = 0;
+    // Fields after "(comm)" start at #3 (state); utime/stime are #14/#15
+    for (int i = 3; i <= 15 && (fields >> field); ++i) {
+        if (i == 14) {
+            utime = std::stoll(field);
+        } else if (i == 15) {
+            stime = std::stoll(field);
+        }
+    }
+    return utime + stime;
+}
+
+bool starts_with(const std::string& s, const char* prefix) {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+struct FrameSample {
+    uint32_t connection;
+    uint32_t frame_seq;
+    int64_t send_us;
+    int64_t recv_us;
+};
+
+// One io thread with its own client endpoint; all stats are thread-local
+class Worker {
+private:
+    struct Connection {
+        client_t::connection_ptr con;
+        std::unordered_map<uint32_t, uint32_t> last_sample;  // entity id -> sample sequence
+        bool open;
+    };
+
+    asio::io_context io_;
+    client_t client_;
+    std::vector<Connection> connections_;
+    bool binary_;
+    bool keep_samples_;
+
+public:
+    LatencyHistogram latency_us;
+    std::vector<FrameSample> samples;
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t records;
+    uint64_t lost;
+    uint64_t snapshots;
+    uint64_t opened;
+    uint64_t failed;
+    uint64_t closed;
+
+    Worker(bool binary, bool keep_samples)
+        : binary_(binary)
+        , keep_samples_(keep_samples)
+        , frames(0)
+        , bytes(0)
+        , records(0)
+        , lost(0)
+        , snapshots(0)
+        , opened(0)
+        , failed(0)
+        , closed(0)
+    {
+        client_.clear_access_channels(websocketpp::log::alevel::all);
+        client_.clear_error_channels(websocketpp::log::elevel::all);
+        client_.init_asio(&io_);
+    }
+
+    void connect(const std::string& url) {
+        size_t index = connections_.size();
+        websocketpp::lib::error_code ec;
+        client_t::connection_ptr con = client_.get_connection(url, ec);
+        if (ec) {
+            failed++;
+            return;
+        }
+        if (binary_) {
+            con->add_subprotocol(CoordinateCodec::binary_subprotocol());
+        }
+
+        Connection entry = {con, std::unordered_map<uint32_t, uint32_t>(), false};
+        connections_.push_back(entry);
+        con->set_open_handler([this, index](websocketpp::connection_hdl) {
+            connections_[index].open = true;
+            opened++;
+        });
+        con->set_fail_handler([this](websocketpp::connection_hdl) {
+            failed++;
+        });
+        con->set_close_handler([this, index](websocketpp::connection_hdl) {
+            connections_[index].open = false;
+            closed++;
+        });
+        con->set_message_handler([this, index](websocketpp::connection_hdl, client_t::message_ptr msg) {
+            on_message(static_cast<uint32_t>(index), msg);
+        });
+        client_.connect(con);
+    }
+
+    // Samples of an entity carry consecutive sequences at the source, so a
+    // jump means the connection never saw the ones in between. A snapshot
+    // re-bases the entity; sequence 0 is a dead-reckoned fill-in.
+    void on_record(Connection& c, uint32_t entity_id, uint32_t sequence, bool snapshot) {
+        if (sequence == 0) {
+            return;
+        }
+        auto result = c.last_sample.insert(std::make_pair(entity_id, sequence));
+        if (!snapshot) {
+            records++;
+        }
+        if (result.second) {
+            return;
+        }
+        uint32_t& last = result.first->second;
+        if (snapshot) {
+            last = sequence;
+        } else if (sequence > last) {
+            lost += sequence - last - 1;
+            last = sequence;
+        }
+    }
+
+    void record_latency(uint32_t index, uint32_t frame_seq, int64_t send_us, int64_t recv_us) {
+        latency_us.record(recv_us - send_us);
+        if (keep_samples_) {
+            FrameSample sample = {index, frame_seq, send_us, recv_us};
+            samples.push_back(sample);
+        }
+    }
+
+    // {"type":"delta","seq":N,"sent":T,"updates":[{"id":I,...,"seq":S},...]}
+    void on_json(uint32_t index, const std::string& payload, int64_t recv_us) {
+        bool snapshot = starts_with(payload, "{\"type\":\"snapshot\",");
+        if (!snapshot && !starts_with(payload, "{\"type\":\"delta\",")) {
+            return;  // command reply
+        }
+        const char* p = payload.c_str();
+        const char* seq = std::strstr(p, "\"seq\":");
+        const char* sent = std::strstr(p, "\"sent\":");
+        const char* updates = std::strstr(p, "\"updates\":[");
+        if (!seq || !sent || !updates) {
+            return;
+        }
+        if (snapshot) {
+            snapshots++;
+        }
+
+        Connection& c = connections_[index];
+        for (const char* id = std::strstr(updates, "{\"id\":"); id; id = std::strstr(id + 1, "{\"id\":")) {
+            const char* sample_seq = std::strstr(id, "\"seq\":");
+            if (!sample_seq) {
+                break;
+            }
+            on_record(c, static_cast<uint32_t>(std::strtoul(id + 6, nullptr, 10)),
+                      static_cast<uint32_t>(std::strtoul(sample_seq + 6, nullptr, 10)), snapshot);
+        }
+        if (!snapshot) {
+            record_latency(index, static_cast<uint32_t>(std::strtoul(seq + 6, nullptr, 10)),
+                           std::strtoll(sent + 7, nullptr, 10), recv_us);
+        }
+    }
+
+    void on_message(uint32_t index, client_t::message_ptr msg) {
+        int64_t recv_us = system_now_us();
+        const std::string& payload = msg->get_payload();
+        frames++;
+        bytes += payload.size();
+
+        if (msg->get_opcode() != websocketpp::frame::opcode::binary) {
+            on_json(index, payload, recv_us);
+            return;
+        }
+
+        uint8_t frame_type;
+        uint16_t count;
+        uint32_t frame_seq;
+        int64_t send_us;
+        if (!CoordinateCodec::decode_header(payload.data(), payload.size(),
+                                            frame_type, count, frame_seq, send_us)) {
+            return;
+        }
+
+        Connection& c = connections_[index];
+        bool snapshot = frame_type == CoordinateCodec::FRAME_SNAPSHOT;
+        if (snapshot) {
+            snapshots++;
+        }
+        for (uint16_t i = 0; i < count; ++i) {
+            CoordinateData record = CoordinateCodec::decode_record(payload.data(), i);
+            on_record(c, record.entity_id, record.sequence, snapshot);
+        }
+
+        // Snapshots are sent on connect, not fanned out; keep them out of the latency figures
+        if (!snapshot) {
+            record_latency(index, frame_seq, send_us, recv_us);
+        }
+    }
+
+    void close_all() {
+        for (auto& c : connections_) {
+            if (c.open) {
+                websocketpp::lib::error_code ec;
+                c.con->close(websocketpp::close::status::going_away, "load test done", ec);
+            }
+        }
+    }
+
+    size_t open_connections() const {
+        size_t n = 0;
+        for (const auto& c : connections_) {
+            n += c.open ? 1 : 0;
+        }
+        return n;
+    }
+
+    asio::io_context& io() {
+        return io_;
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    AppOptions options;
+    std::string url;
+    uint32_t connections = 0;
+    uint32_t thread_count = 0;
+    uint32_t ramp_per_s = 0;
+    uint32_t duration_s = 0;
+    bool binary = true;
+    int server_pid = 0;
+    std::string samples_csv;
+    std::string histogram_csv;
+    try {
+        options = AppOptions::parse(argc, argv, false);
+        url = options.get_string("url", "ws://127.0.0.1:8081");
+        connections = options.get_uint("connections", 1000);
+        thread_count = std::max<uint32_t>(1, options.get_uint("threads", 4));
+        ramp_per_s = std::max<uint32_t>(1, options.get_uint("ramp", 500));
+        duration_s = options.get_uint("duration", 30);
+        binary = options.get_string("format", "binary") != "json";
+        server_pid = static_cast<int>(options.get_uint("server-pid", 0));
+        samples_csv = options.get_string("samples-csv");
+        histogram_csv = options.get_string("histogram-csv");
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (options.has("help")) {
+        std::cout << "Usage: " << argv[0] << " [options]" << std::endl
+                  << "  --url URL           server to load (default ws://127.0.0.1:8081)" << std::endl
+                  << "  --connections N     concurrent clients (default 1000)" << std::endl
+                  << "  --threads N         client io threads (default 4)" << std::endl
+                  << "  --ramp N            new connections per second (default 500)" << std::endl
+                  << "  --duration S        measurement time after ramp-up (default 30)" << std::endl
+                  << "  --format F          binary|json (default binary)" << std::endl
+                  << "  --server-pid PID    report the server's CPU usage" << std::endl
+                  << "  --samples-csv PATH  write every frame's send/receive time" << std::endl
+                  << "  --histogram-csv PATH write the latency histogram" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker(binary, !samples_csv.empty())));
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>>> guards;
+    for (auto& w : workers) {
+        guards.push_back(std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>>(
+            new asio::executor_work_guard<asio::io_context::executor_type>(w->io().get_executor())));
+        Worker* worker = w.get();
+        threads.emplace_back([worker]() { worker->io().run(); });
+    }
+
+    std::cout << "[ws_loadgen] " << connections << " connections to " << url
+              << " on " << thread_count << " threads, " << (binary ? "binary" : "json")
+              << " frames" << std::endl;
+
+    // Ramp up: connections are created on their worker's io thread
+    auto ramp_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < connections && !g_stop.load(); ++i) {
+        Worker* worker = workers[i % thread_count].get();
+        asio::post(worker->io(), [worker, url]() { worker->connect(url); });
+        std::this_thread::sleep_until(ramp_start + std::chrono::microseconds(
+            static_cast<int64_t>(i + 1) * 1000000 / ramp_per_s));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    // Measurement window: reset stats so ramp-up does not skew them
+    for (auto& w : workers) {
+        Worker* worker = w.get();
+        asio::post(worker->io(), [worker]() {
+            worker->latency_us.reset();
+            worker->samples.clear();
+            worker->frames = worker->bytes = worker->records = worker->lost = worker->snapshots = 0;
+        });
+    }
+    long long cpu_start = server_pid > 0 ? process_cpu_ticks(server_pid) : -1;
+    auto window_start = std::chrono::steady_clock::now();
+    while (!g_stop.load() &&
+           std::chrono::steady_clock::now() - window_start < std::chrono::seconds(duration_s)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    double window_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - window_start).count();
+    long long cpu_end = server_pid > 0 ? process_cpu_ticks(server_pid) : -1;
+
+    // Snapshot open connections before closing, then stop the io threads
+    size_t open_at_end = 0;
+    for (auto& w : workers) {
+        Worker* worker = w.get();
+        std::promise<size_t> open_count;
+        auto future = open_count.get_future();
+        asio::post(worker->io(), [worker, &open_count]() {
+            open_count.set_value(worker->open_connections());
+            worker->close_all();
+        });
+        open_at_end += future.get();
+    }
+    guards.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    for (auto& w : workers) {
+        w->io().stop();
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    LatencyHistogram latency;
+    uint64_t frames = 0, bytes = 0, records = 0, lost = 0, snapshots = 0, opened = 0, failed = 0;
+    for (auto& w : workers) {
+        latency.merge(w->latency_us);
+        frames += w->frames;
+        bytes += w->bytes;
+        records += w->records;
+        lost += w->lost;
+        snapshots += w->snapshots;
+        opened += w->opened;
+        failed += w->failed;
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Connections: requested=" << connections << " opened=" << opened
+              << " failed=" << failed << " open_at_end=" << open_at_end << std::endl;
+    std::cout << "Window: " << window_s << " s" << std::endl;
+    std::cout << "Frames: " << frames << " (" << frames / window_s << "/s, "
+              << bytes / window_s / (1024.0 * 1024.0) << " MB/s), snapshots=" << snapshots << std::endl;
+    std::cout << "Source samples: " << records << " received, " << lost << " missed ("
+              << (records + lost > 0 ? 100.0 * lost / (records + lost) : 0.0) << "%)" << std::endl;
+    std::cout << "Fan-out latency: " << latency.summary("us") << std::endl;
+    if (cpu_start >= 0 && cpu_end >= 0) {
+        double cpu_s = static_cast<double>(cpu_end - cpu_start) / sysconf(_SC_CLK_TCK);
+        std::cout << "Server CPU: " << 100.0 * cpu_s / window_s << "% of one core" << std::endl;
+    }
+    std::cout << "========================================" << std::endl;
+
+    if (!histogram_csv.empty()) {
+        FILE* out = fopen(histogram_csv.c_str(), "w");
+        if (out) {
+            latency.write_csv(out);
+            fclose(out);
+        }
+    }
+    if (!samples_csv.empty()) {
+        FILE* out = fopen(samples_csv.c_str(), "w");
+        if (out) {
+            fprintf(out, "worker,connection,frame_seq,send_us,recv_us\n");
+            for (size_t wi = 0; wi < workers.size(); ++wi) {
+                for (const auto& s : workers[wi]->samples) {
+                    fprintf(out, "%zu,%u,%u,%lld,%lld\n", wi, s.connection, s.frame_seq,
+                            static_cast<long long>(s.send_us), static_cast<long long>(s.recv_us));
+                }
+            }
+            fclose(out);
+        }
+    }
+    return EXIT_SUCCESS;
+}
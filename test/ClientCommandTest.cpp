@@ -0,0 +1,79 @@
+// ClientCommand number parsing: everything here arrives straight off a
+// WebSocket, so malformed and out-of-range values must be rejected, not cast.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ClientCommand.hpp"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+ClientCommand parse(const std::string& line) {
+    ClientCommand cmd;
+    CHECK(ClientCommand::parse(line, cmd));
+    return cmd;
+}
+
+bool uints(const std::string& value, std::vector<uint32_t>& out) {
+    return parse("SUB ids=" + value).get_uints("ids", out);
+}
+
+} // namespace
+
+int main() {
+    std::vector<uint32_t> ids;
+
+    // In range
+    CHECK(uints("0,1,4294967295", ids));
+    CHECK(ids.size() == 3 && ids[0] == 0 && ids[1] == 1 && ids[2] == 4294967295u);
+    CHECK(uints("1e3", ids) && ids.size() == 1 && ids[0] == 1000);
+
+    // Out of range
+    CHECK(!uints("4294967296", ids));
+    CHECK(!uints("5e9", ids));
+    CHECK(!uints("1e20", ids));
+    CHECK(!uints("1,1e300", ids));
+
+    // Negative, fractional
+    CHECK(!uints("-1", ids));
+    CHECK(!uints("-0.5", ids));
+    CHECK(!uints("1.5", ids));
+    CHECK(!uints("0.999999", ids));
+
+    // Not finite, not a number
+    CHECK(!uints("nan", ids));
+    CHECK(!uints("inf", ids));
+    CHECK(!uints("-inf", ids));
+    CHECK(!uints("1e999", ids));
+    CHECK(!uints("abc", ids));
+    CHECK(!uints("1,,2", ids));
+    CHECK(!uints("", ids));
+
+    // Doubles share the finiteness check
+    double d = 0.0;
+    CHECK(parse("QUERY radius=250.5").get_double("radius", d) && d == 250.5);
+    CHECK(!parse("QUERY radius=nan").get_double("radius", d));
+    CHECK(!parse("QUERY radius=1e999").get_double("radius", d));
+    CHECK(!parse("QUERY radius=1,2").get_double("radius", d));
+
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "ClientCommandTest: ok" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+// Virtual-time checks for TimingWheel: deadlines that cross the top level's
+// horizon (2^26 ticks, ~18.6 h at 1 ms) must not wait for another turn.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "AsyncLogger.hpp"
+#include "SimClock.hpp"
+#include "TimingWheel.hpp"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            failures++; \
+        } \
+    } while (0)
+
+int64_t elapsed_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(SimClock::elapsed()).count();
+}
+
+} // namespace
+
+int main() {
+    SimClock::enable_virtual(1700000000000LL);
+    asio::io_context io;
+    TimingWheel wheel(io);
+
+    const int64_t kHour = 3600 * 1000;
+    const int64_t kRunMs = 40 * kHour;  // two horizon boundaries
+
+    uint64_t runs = 0;
+    int64_t last_run_ms = 0;
+    int64_t max_gap_ms = 0;
+    wheel.schedule_periodic("periodic", std::chrono::milliseconds(50), [&]() {
+        int64_t now = elapsed_ms();
+        max_gap_ms = std::max(max_gap_ms, now - last_run_ms);
+        last_run_ms = now;
+        runs++;
+    });
+
+    int64_t fired_20h = -1;
+    int64_t fired_30h = -1;
+    wheel.schedule_once("20h", std::chrono::hours(20), [&]() { fired_20h = elapsed_ms(); });
+    wheel.schedule_once("30h", std::chrono::hours(30), [&]() { fired_30h = elapsed_ms(); });
+    wheel.schedule_once("end", std::chrono::milliseconds(kRunMs) + std::chrono::milliseconds(1), [&]() {
+        wheel.stop();
+        io.stop();
+    });
+    io.run();
+
+    CHECK(runs == static_cast<uint64_t>(kRunMs / 50));
+    CHECK(max_gap_ms == 50);
+    CHECK(fired_20h == 20 * kHour);
+    CHECK(fired_30h == 30 * kHour);
+
+    AsyncLogger::instance().shutdown();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "TimingWheelTest: " << runs << " runs, max gap " << max_gap_ms << " ms" << std::endl;
+    return EXIT_SUCCESS;
+}